@@ -0,0 +1,392 @@
+#pragma once
+
+#include "Matrix.h"
+
+#include <vector>
+#include <algorithm>
+#include <limits>
+
+namespace cg
+{
+	template <class T>
+	class AABB
+	{
+	public:
+		AABB();
+		AABB(Vector<T, 3> min, Vector<T, 3> max);
+
+		void extend(AABB<T> box);
+		void extend(Vector<T, 3> point);
+		Vector<T, 3> getCenter();
+		T getSurfaceArea();
+		bool isEmpty();
+
+		Vector<T, 3> min;
+		Vector<T, 3> max;
+	};
+
+	// flacher knoten: innere knoten haben count == 0, das linke kind liegt direkt dahinter, das rechte bei offset
+	template <class T>
+	struct BVHNode
+	{
+		T min[3];
+		T max[3];
+		unsigned int offset;
+		unsigned int count;
+	};
+
+	// bounding volume hierarchy ueber beliebige primitive, gebaut mit binned SAH
+	// die primitive werden ueber ihre position in getIndices() angesprochen, so dass ein blatt immer einen zusammenhaengenden bereich abdeckt
+	template <class T>
+	class BVH
+	{
+	public:
+		BVH();
+		BVH(unsigned int maxLeafSize);
+
+		void build(const std::vector<AABB<T>>& bounds);
+
+		// leaf(first, count, tmax) testet die primitive [first, first + count) und gibt true zurueck wenn tmax verkleinert wurde
+		template <class F>
+		bool intersect(Vector<T, 3> origin, Vector<T, 3> direction, T& tmax, F leaf) const;
+		// wie intersect, hoert aber beim ersten blatt auf, fuer das leaf true zurueckgibt (schatten- und AO strahlen)
+		template <class F>
+		bool occluded(Vector<T, 3> origin, Vector<T, 3> direction, T tmax, F leaf) const;
+
+		const std::vector<BVHNode<T>>& getNodes() const;
+		const std::vector<unsigned int>& getIndices() const;
+		AABB<T> getBounds() const;
+	private:
+		unsigned int buildNode(const std::vector<AABB<T>>& bounds, std::vector<Vector<T, 3>>& centers, unsigned int begin, unsigned int end, unsigned int depth);
+		static bool intersectNode(const BVHNode<T>& node, const T origin[3], const T inverseDirection[3], T tmax, T& tnear);
+		template <bool anyHit, class F>
+		bool traverse(Vector<T, 3> origin, Vector<T, 3> direction, T& tmax, F leaf) const;
+
+		static constexpr unsigned int binCount = 16;
+		static constexpr unsigned int stackSize = 64;
+		// ab dieser tiefe wird nur noch in der mitte geteilt, damit der traversierungsstack nicht ueberlaeuft
+		static constexpr unsigned int medianDepth = stackSize / 2;
+
+		unsigned int maxLeafSize;
+		std::vector<BVHNode<T>> nodes;
+		std::vector<unsigned int> indices;
+	};
+
+	// impl ---------------------------------
+
+	template<class T>
+	inline AABB<T>::AABB()
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			min(i) = std::numeric_limits<T>::max();
+			max(i) = std::numeric_limits<T>::lowest();
+		}
+	}
+
+	template<class T>
+	inline AABB<T>::AABB(Vector<T, 3> min, Vector<T, 3> max) : min(min), max(max)
+	{
+	}
+
+	template<class T>
+	inline void AABB<T>::extend(AABB<T> box)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			min(i) = (std::min)(min(i), box.min(i));
+			max(i) = (std::max)(max(i), box.max(i));
+		}
+	}
+
+	template<class T>
+	inline void AABB<T>::extend(Vector<T, 3> point)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			min(i) = (std::min)(min(i), point(i));
+			max(i) = (std::max)(max(i), point(i));
+		}
+	}
+
+	template<class T>
+	inline Vector<T, 3> AABB<T>::getCenter()
+	{
+		return (min + max) * T(0.5);
+	}
+
+	template<class T>
+	inline T AABB<T>::getSurfaceArea()
+	{
+		if (isEmpty())
+			return 0;
+		T x = max(0) - min(0);
+		T y = max(1) - min(1);
+		T z = max(2) - min(2);
+		return 2 * (x * y + y * z + z * x);
+	}
+
+	template<class T>
+	inline bool AABB<T>::isEmpty()
+	{
+		return min(0) > max(0) || min(1) > max(1) || min(2) > max(2);
+	}
+
+	template<class T>
+	inline BVH<T>::BVH() : BVH(4)
+	{
+	}
+
+	template<class T>
+	inline BVH<T>::BVH(unsigned int maxLeafSize) : maxLeafSize((std::max)(maxLeafSize, 1u))
+	{
+	}
+
+	template<class T>
+	inline void BVH<T>::build(const std::vector<AABB<T>>& bounds)
+	{
+		nodes.clear();
+		indices.resize(bounds.size());
+		if (bounds.empty())
+			return;
+
+		std::vector<Vector<T, 3>> centers(bounds.size());
+		for (unsigned int i = 0; i < bounds.size(); i++)
+		{
+			indices[i] = i;
+			centers[i] = AABB<T>(bounds[i]).getCenter();
+		}
+
+		nodes.reserve(2 * bounds.size());
+		buildNode(bounds, centers, 0, bounds.size(), 0);
+		nodes.shrink_to_fit();
+	}
+
+	template<class T>
+	inline unsigned int BVH<T>::buildNode(const std::vector<AABB<T>>& bounds, std::vector<Vector<T, 3>>& centers, unsigned int begin, unsigned int end, unsigned int depth)
+	{
+		unsigned int index = nodes.size();
+		nodes.push_back({});
+
+		AABB<T> box;
+		AABB<T> centerBox;
+		for (unsigned int i = begin; i < end; i++)
+		{
+			box.extend(bounds[indices[i]]);
+			centerBox.extend(centers[indices[i]]);
+		}
+		for (int i = 0; i < 3; i++)
+		{
+			nodes[index].min[i] = box.min(i);
+			nodes[index].max[i] = box.max(i);
+		}
+
+		unsigned int count = end - begin;
+		if (count <= maxLeafSize)
+		{
+			nodes[index].offset = begin;
+			nodes[index].count = count;
+			return index;
+		}
+
+		int axis = 0;
+		Vector<T, 3> extent = centerBox.max - centerBox.min;
+		if (extent(1) > extent(axis))
+			axis = 1;
+		if (extent(2) > extent(axis))
+			axis = 2;
+
+		unsigned int middle = begin;
+		if (extent(axis) > 0 && depth < medianDepth)
+		{
+			AABB<T> binBounds[binCount];
+			unsigned int binCounts[binCount] = {};
+			T scale = binCount / extent(axis);
+			auto binOf = [&](unsigned int primitive)
+			{
+				unsigned int bin = (centers[primitive][axis] - centerBox.min(axis)) * scale;
+				return (std::min)(bin, binCount - 1);
+			};
+
+			for (unsigned int i = begin; i < end; i++)
+			{
+				unsigned int bin = binOf(indices[i]);
+				binBounds[bin].extend(bounds[indices[i]]);
+				binCounts[bin]++;
+			}
+
+			// von rechts aufsummieren, dann von links die kosten jeder trennung auswerten
+			T rightAreas[binCount];
+			unsigned int rightCounts[binCount];
+			AABB<T> accumulated;
+			unsigned int accumulatedCount = 0;
+			for (int i = binCount - 1; i > 0; i--)
+			{
+				accumulated.extend(binBounds[i]);
+				accumulatedCount += binCounts[i];
+				rightAreas[i] = accumulated.getSurfaceArea();
+				rightCounts[i] = accumulatedCount;
+			}
+
+			T bestCost = std::numeric_limits<T>::max();
+			unsigned int bestSplit = 0;
+			accumulated = AABB<T>();
+			accumulatedCount = 0;
+			for (unsigned int i = 1; i < binCount; i++)
+			{
+				accumulated.extend(binBounds[i - 1]);
+				accumulatedCount += binCounts[i - 1];
+				if (accumulatedCount == 0 || rightCounts[i] == 0)
+					continue;
+				T cost = accumulated.getSurfaceArea() * accumulatedCount + rightAreas[i] * rightCounts[i];
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					bestSplit = i;
+				}
+			}
+
+			if (bestSplit > 0)
+				middle = std::partition(indices.begin() + begin, indices.begin() + end, [&](unsigned int primitive) { return binOf(primitive) < bestSplit; }) - indices.begin();
+		}
+
+		if (middle == begin || middle == end)
+		{
+			middle = begin + count / 2;
+			std::nth_element(indices.begin() + begin, indices.begin() + middle, indices.begin() + end, [&](unsigned int a, unsigned int b) { return centers[a][axis] < centers[b][axis]; });
+		}
+
+		buildNode(bounds, centers, begin, middle, depth + 1);
+		unsigned int right = buildNode(bounds, centers, middle, end, depth + 1);
+		nodes[index].offset = right;
+		nodes[index].count = 0;
+		return index;
+	}
+
+	template<class T>
+	inline bool BVH<T>::intersectNode(const BVHNode<T>& node, const T origin[3], const T inverseDirection[3], T tmax, T& tnear)
+	{
+		T tmin = 0;
+		for (int i = 0; i < 3; i++)
+		{
+			T t1 = (node.min[i] - origin[i]) * inverseDirection[i];
+			T t2 = (node.max[i] - origin[i]) * inverseDirection[i];
+			if (t1 > t2)
+				std::swap(t1, t2);
+			// NaN (0 * inf) faellt hier durch die vergleiche und schraenkt das intervall nicht ein
+			if (t1 > tmin)
+				tmin = t1;
+			if (t2 < tmax)
+				tmax = t2;
+		}
+		tnear = tmin;
+		return tmin <= tmax;
+	}
+
+	template<class T>
+	template<class F>
+	inline bool BVH<T>::intersect(Vector<T, 3> origin, Vector<T, 3> direction, T& tmax, F leaf) const
+	{
+		return traverse<false>(origin, direction, tmax, leaf);
+	}
+
+	template<class T>
+	template<class F>
+	inline bool BVH<T>::occluded(Vector<T, 3> origin, Vector<T, 3> direction, T tmax, F leaf) const
+	{
+		return traverse<true>(origin, direction, tmax, leaf);
+	}
+
+	template<class T>
+	template<bool anyHit, class F>
+	inline bool BVH<T>::traverse(Vector<T, 3> origin, Vector<T, 3> direction, T& tmax, F leaf) const
+	{
+		if (nodes.empty())
+			return false;
+
+		T o[3] = { origin(0), origin(1), origin(2) };
+		T inverseDirection[3] = { T(1) / direction(0), T(1) / direction(1), T(1) / direction(2) };
+
+		T tnear;
+		if (!intersectNode(nodes[0], o, inverseDirection, tmax, tnear))
+			return false;
+
+		struct Entry
+		{
+			unsigned int node;
+			T tnear;
+		};
+		Entry stack[stackSize];
+		unsigned int stackCount = 0;
+		stack[stackCount++] = { 0, tnear };
+
+		bool hit = false;
+		while (stackCount > 0)
+		{
+			Entry entry = stack[--stackCount];
+			if (entry.tnear > tmax)
+				continue;
+
+			unsigned int current = entry.node;
+			while (true)
+			{
+				const BVHNode<T>& node = nodes[current];
+				if (node.count > 0)
+				{
+					if (leaf(node.offset, node.count, tmax))
+					{
+						if (anyHit)
+							return true;
+						hit = true;
+					}
+					break;
+				}
+
+				T near1, near2;
+				bool hit1 = intersectNode(nodes[current + 1], o, inverseDirection, tmax, near1);
+				bool hit2 = intersectNode(nodes[node.offset], o, inverseDirection, tmax, near2);
+				if (hit1 && hit2)
+				{
+					// naeheres kind zuerst, das andere kommt auf den stack
+					if (near1 <= near2)
+					{
+						stack[stackCount++] = { node.offset, near2 };
+						current = current + 1;
+					}
+					else
+					{
+						stack[stackCount++] = { current + 1, near1 };
+						current = node.offset;
+					}
+				}
+				else if (hit1)
+					current = current + 1;
+				else if (hit2)
+					current = node.offset;
+				else
+					break;
+			}
+		}
+		return hit;
+	}
+
+	template<class T>
+	inline const std::vector<BVHNode<T>>& BVH<T>::getNodes() const
+	{
+		return nodes;
+	}
+
+	template<class T>
+	inline const std::vector<unsigned int>& BVH<T>::getIndices() const
+	{
+		return indices;
+	}
+
+	template<class T>
+	inline AABB<T> BVH<T>::getBounds() const
+	{
+		if (nodes.empty())
+			return AABB<T>();
+		return AABB<T>({ nodes[0].min[0], nodes[0].min[1], nodes[0].min[2] }, { nodes[0].max[0], nodes[0].max[1], nodes[0].max[2] });
+	}
+}
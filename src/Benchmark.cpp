@@ -0,0 +1,1351 @@
+#include "PathTracing2.h"
+#include "SceneFile.h"
+#include "MeshFile.h"
+#include "TriangleMesh.h"
+#include "Instance.h"
+#include "DistanceField.h"
+#include "WavefrontRenderer.h"
+#include "Utils.h"
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <memory>
+#include <atomic>
+#include <new>
+#include <cstdlib>
+#include <limits>
+#include <fstream>
+#include <cstdio>
+
+using namespace cg;
+
+#ifdef CGTESTS_COUNT_ALLOCATIONS
+// zaehlt alle heap allokationen im programm, damit der benchmark zeigen kann dass der strahlenpfad ohne auskommt
+// nur mit der cmake option CGTESTS_COUNT_ALLOCATIONS, sonst traefe es jede allokation im ganzen programm
+// das sized delete der standardbibliothek ruft das unsized delete auf, es reicht also dieses eine
+std::atomic<unsigned long long> allocationCount(0);
+
+void* operator new(std::size_t size)
+{
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	if (void* p = std::malloc(size == 0 ? 1 : size))
+		return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+#endif
+
+namespace benchmark
+{
+	using Clock = std::chrono::steady_clock;
+
+	double seconds(Clock::time_point start)
+	{
+		return std::chrono::duration<double>(Clock::now() - start).count();
+	}
+
+	// zufaellige kugeln in einem wuerfel, der radius schrumpft mit der anzahl damit die dichte ungefaehr gleich bleibt
+	std::vector<std::unique_ptr<path2::Sphere>> randomSpheres(unsigned int count, unsigned int seed)
+	{
+		std::uniform_real_distribution<double> random(-50.0, 50.0);
+		std::default_random_engine generator(seed);
+		double radius = 30.0 / std::cbrt((double)count);
+
+		std::vector<std::unique_ptr<path2::Sphere>> spheres;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			auto sphere = std::make_unique<path2::Sphere>();
+			sphere->pos = { random(generator), random(generator), random(generator) };
+			sphere->size = radius * (0.5 + (random(generator) + 50.0) / 100.0);
+			sphere->color = { 1.0, 1.0, 1.0 };
+			sphere->transmission = 0.0;
+			spheres.push_back(std::move(sphere));
+		}
+		return spheres;
+	}
+
+	std::vector<std::tuple<Vector<double, 3>, Vector<double, 3>>> randomRays(unsigned int count, unsigned int seed)
+	{
+		std::uniform_real_distribution<double> random(-1.0, 1.0);
+		std::default_random_engine generator(seed);
+
+		std::vector<std::tuple<Vector<double, 3>, Vector<double, 3>>> rays;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			Vector<double, 3> origin = { random(generator) * 50.0, random(generator) * 50.0, random(generator) * 50.0 };
+			Vector<double, 3> direction = path2::normalize(Vector<double, 3>{ random(generator), random(generator), random(generator) });
+			rays.push_back({ origin, direction });
+		}
+		return rays;
+	}
+
+	// schiesst strahlen bis alle verbraucht sind oder das zeitbudget abgelaufen ist, gibt strahlen pro sekunde und die anzahl zurueck
+	template <class F>
+	std::tuple<double, unsigned int> raysPerSecond(std::vector<std::tuple<Vector<double, 3>, Vector<double, 3>>>& rays, double budget, F traceRay)
+	{
+		auto start = Clock::now();
+		unsigned int count = 0;
+		for (auto [origin, direction] : rays)
+		{
+			traceRay(origin, direction);
+			count++;
+			if (seconds(start) > budget)
+				break;
+		}
+		return { count / seconds(start), count };
+	}
+
+	void bvh()
+	{
+		std::cout << std::setw(10) << "spheres" << std::setw(12) << "build ms" << std::setw(16) << "linear rays/s" << std::setw(16) << "bvh rays/s" << std::setw(12) << "speedup" << std::setw(12) << "mismatches" << std::endl;
+
+		auto rays = randomRays(100000, 1);
+		for (unsigned int count : { 100u, 1000u, 10000u, 100000u, 1000000u })
+		{
+			auto spheres = randomSpheres(count, count);
+			std::vector<path2::RayTraceObject*> list;
+			path2::Scene scene;
+			for (auto& sphere : spheres)
+			{
+				list.push_back(sphere.get());
+				scene.add(sphere.get());
+			}
+
+			auto start = Clock::now();
+			scene.build();
+			double buildTime = seconds(start) * 1000.0;
+
+			std::vector<path2::RayTraceObject*> linearHits(rays.size());
+			unsigned int linearIndex = 0;
+			auto [linearRate, linearCount] = raysPerSecond(rays, 1.0, [&](Vector<double, 3> origin, Vector<double, 3> direction)
+			{
+				path2::Hit hit;
+				linearHits[linearIndex++] = path2::trace(origin, direction, list, hit) ? hit.object : nullptr;
+			});
+
+			std::vector<path2::RayTraceObject*> bvhHits(rays.size());
+			unsigned int bvhIndex = 0;
+			auto [bvhRate, bvhCount] = raysPerSecond(rays, 1.0, [&](Vector<double, 3> origin, Vector<double, 3> direction)
+			{
+				path2::Hit hit;
+				bvhHits[bvhIndex++] = path2::trace(origin, direction, scene, hit) ? hit.object : nullptr;
+			});
+
+			// beide verfahren muessen fuer die gemeinsamen strahlen das gleiche objekt treffen
+			unsigned int mismatches = 0;
+			for (unsigned int i = 0; i < (std::min)(linearCount, bvhCount); i++)
+			{
+				if (linearHits[i] != bvhHits[i])
+					mismatches++;
+			}
+
+			std::cout << std::setw(10) << count << std::setw(12) << std::fixed << std::setprecision(1) << buildTime << std::setw(16) << std::setprecision(0) << linearRate << std::setw(16) << bvhRate << std::setw(11) << std::setprecision(1) << bvhRate / linearRate << "x" << std::setw(12) << mismatches << std::endl;
+		}
+	}
+
+	// misst die heap allokationen pro strahl fuer trace, tracePlus und den ganzen pfad in tracePixel
+	void allocations()
+	{
+#ifndef CGTESTS_COUNT_ALLOCATIONS
+		std::cout << "allocation counting is off, configure with -DCGTESTS_COUNT_ALLOCATIONS=ON" << std::endl;
+#else
+		auto spheres = randomSpheres(10000, 2);
+		path2::TestPlane plane;
+		plane.color = { 1.0, 1.0, 1.0 };
+		plane.transmission = 0.0;
+
+		std::vector<path2::RayTraceObject*> list;
+		path2::Scene scene;
+		list.push_back(&plane);
+		scene.add(&plane);
+		for (auto& sphere : spheres)
+		{
+			list.push_back(sphere.get());
+			scene.add(sphere.get());
+		}
+		scene.build();
+
+		auto rays = randomRays(10000, 3);
+
+		auto measure = [&](const char* name, unsigned int count, auto traceRay)
+		{
+			unsigned long long before = allocationCount.load();
+			auto start = Clock::now();
+			for (unsigned int i = 0; i < count; i++)
+				traceRay(std::get<0>(rays[i]), std::get<1>(rays[i]));
+			double time = seconds(start);
+			unsigned long long allocations = allocationCount.load() - before;
+			std::cout << std::setw(24) << name << std::setw(12) << count << std::setw(14) << allocations << std::setw(16) << std::fixed << std::setprecision(0) << count / time << std::endl;
+		};
+
+		std::cout << std::setw(24) << "query" << std::setw(12) << "rays" << std::setw(14) << "allocations" << std::setw(16) << "rays/s" << std::endl;
+		measure("trace (linear)", 1000, [&](Vector<double, 3> origin, Vector<double, 3> direction)
+		{
+			path2::Hit hit;
+			path2::trace(origin, direction, list, hit);
+		});
+		measure("trace (scene)", rays.size(), [&](Vector<double, 3> origin, Vector<double, 3> direction)
+		{
+			path2::Hit hit;
+			path2::trace(origin, direction, scene, hit);
+		});
+		measure("tracePlus (scene)", rays.size(), [&](Vector<double, 3> origin, Vector<double, 3> direction)
+		{
+			path2::tracePlus(origin, direction, scene);
+		});
+		unsigned int pixel = 0;
+		measure("tracePixel (scene)", 1000, [&](Vector<double, 3> origin, Vector<double, 3> direction)
+		{
+			Random random(pixel++, 0);
+			path2::tracePixel(origin, direction, scene, 4, random);
+		});
+#endif
+	}
+
+	// schnitttests pro sekunde ueber alle kugeln ohne BVH: virtuelles Sphere::intersect gegen die gepackten SoA kernel
+	void sphereKernel()
+	{
+		const unsigned int count = 4096;
+		auto spheres = randomSpheres(count, 4);
+		auto rays = randomRays(2000, 5);
+
+		SphereArray<double> packed;
+		SphereArray<float> packedFloat;
+		for (auto& sphere : spheres)
+		{
+			packed.add(sphere->pos, sphere->size);
+			packedFloat.add({ (float)sphere->pos(0), (float)sphere->pos(1), (float)sphere->pos(2) }, (float)sphere->size);
+		}
+
+		std::vector<double> reference(rays.size());
+		auto measure = [&](const char* name, auto intersectAll)
+		{
+			unsigned int mismatches = 0;
+			auto start = Clock::now();
+			for (unsigned int i = 0; i < rays.size(); i++)
+			{
+				double distance = intersectAll(std::get<0>(rays[i]), std::get<1>(rays[i]));
+				if (std::abs(distance - reference[i]) > 1e-3 * (std::max)(1.0, std::abs(reference[i])))
+					mismatches++;
+			}
+			double time = seconds(start);
+			std::cout << std::setw(28) << name << std::setw(18) << std::fixed << std::setprecision(0) << rays.size() * (double)count / time << std::setw(12) << mismatches << std::endl;
+		};
+
+		for (unsigned int i = 0; i < rays.size(); i++)
+		{
+			double tmax = std::numeric_limits<double>::max();
+			unsigned int index;
+			packed.intersectScalar(std::get<0>(rays[i]), std::get<1>(rays[i]), 0, count, 0, tmax, index);
+			reference[i] = tmax;
+		}
+
+		std::cout << std::setw(28) << "kernel" << std::setw(18) << "intersections/s" << std::setw(12) << "mismatches" << std::endl;
+		measure("Sphere::intersect", [&](Vector<double, 3> origin, Vector<double, 3> direction)
+		{
+			path2::Hit hit;
+			double tmax = std::numeric_limits<double>::max();
+			for (auto& sphere : spheres)
+			{
+				if (sphere->intersect(origin, direction, 0, tmax, hit))
+					tmax = hit.distance;
+			}
+			return tmax;
+		});
+		measure("SphereArray<double> scalar", [&](Vector<double, 3> origin, Vector<double, 3> direction)
+		{
+			double tmax = std::numeric_limits<double>::max();
+			unsigned int index;
+			packed.intersectScalar(origin, direction, 0, count, 0, tmax, index);
+			return tmax;
+		});
+		measure("SphereArray<double>", [&](Vector<double, 3> origin, Vector<double, 3> direction)
+		{
+			double tmax = std::numeric_limits<double>::max();
+			unsigned int index;
+			packed.intersect(origin, direction, 0, count, 0, tmax, index);
+			return tmax;
+		});
+		measure("SphereArray<float>", [&](Vector<double, 3> origin, Vector<double, 3> direction)
+		{
+			float tmax = std::numeric_limits<float>::max();
+			unsigned int index;
+			packedFloat.intersect({ (float)origin(0), (float)origin(1), (float)origin(2) }, { (float)direction(0), (float)direction(1), (float)direction(2) }, 0, count, 0, tmax, index);
+			return tmax == std::numeric_limits<float>::max() ? std::numeric_limits<double>::max() : (double)tmax;
+		});
+	}
+
+	// die szene aus path2::raytrace, fuer benchmarks die ganze bilder rendern
+	template <class T>
+	struct TestScene
+	{
+		path2::BasicTestPlane<T> plane;
+		path2::BasicSphere<T> sphere, sphere2, sphere3;
+		path2::BasicScene<T> scene;
+
+		TestScene()
+		{
+			plane.color = { T(1), T(1), T(1) };
+			plane.transmission = T(0);
+			sphere.color = { T(0.8), T(0.8), T(1) };
+			sphere.size = T(1);
+			sphere.pos = { T(0.15), T(1), T(6.5) };
+			sphere.transmission = T(0.4);
+			sphere2.color = { T(1), T(0.8), T(0.8) };
+			sphere2.size = T(0.75);
+			sphere2.pos = { T(-1), T(0.75), T(5.1) };
+			sphere2.transmission = T(0);
+			sphere3.color = { T(0.8), T(1), T(0.8) };
+			sphere3.size = T(0.5);
+			sphere3.pos = { T(0.5), T(0.5), T(5) };
+			sphere3.transmission = T(0);
+			scene.add(&plane);
+			scene.add(&sphere);
+			scene.add(&sphere2);
+			scene.add(&sphere3);
+			scene.build();
+		}
+	};
+
+	// wurzel der mittleren quadratischen abweichung zweier bilder in 0..255
+	double rmse(Bitmap<unsigned char>& a, Bitmap<unsigned char>& b)
+	{
+		double sum = 0;
+		for (unsigned long i = 0; i < a.getTotalSize(); i++)
+		{
+			double difference = (double)a.getData()[i] - (double)b.getData()[i];
+			sum += difference * difference;
+		}
+		return std::sqrt(sum / a.getTotalSize());
+	}
+
+	// gleich viele samples fuer alle pixel gegen adaptive verteilung, fehler gegen ein bild mit vielen samples
+	void adaptiveSampling()
+	{
+		const unsigned int width = 160;
+		const unsigned int height = 160;
+		TestScene<double> test;
+		Vector<double, 3> origin = { 0, 3, -1 };
+
+		path2::ProgressiveRenderer reference(&test.scene, origin, width, height);
+		reference.render(1024);
+		Bitmap<unsigned char> referenceImage = reference.getSnapshot();
+
+		std::cout << std::setw(30) << "mode" << std::setw(16) << "samples" << std::setw(12) << "spp" << std::setw(12) << "rmse" << std::setw(12) << "ms" << std::endl;
+		auto measure = [&](std::string name, unsigned int samples, unsigned int minSamples, double noiseTarget)
+		{
+			path2::ProgressiveRenderer renderer(&test.scene, origin, width, height);
+			renderer.setAdaptive(minSamples, noiseTarget);
+			auto start = Clock::now();
+			renderer.render(samples);
+			double time = seconds(start) * 1000.0;
+			Bitmap<unsigned char> image = renderer.getSnapshot();
+			std::cout << std::setw(30) << name << std::setw(16) << renderer.getSampleTotal() << std::setw(12) << std::fixed << std::setprecision(1) << renderer.getSampleTotal() / (double)(width * height)
+				<< std::setw(12) << std::setprecision(2) << rmse(image, referenceImage) << std::setw(12) << std::setprecision(0) << time << std::endl;
+		};
+
+		for (unsigned int samples : { 16u, 32u, 64u, 128u })
+			measure("uniform " + std::to_string(samples), samples, 0, 0);
+		for (double noiseTarget : { 0.04, 0.02, 0.01 })
+			measure("adaptive 8..256 +-" + std::to_string(noiseTarget).substr(0, 4), 256, 8, noiseTarget);
+	}
+
+	// zeit pro bild fuer verschiedene pfadlaengen, mit russischem roulette waechst der aufwand kaum noch mit der tiefe
+	void pathDepth()
+	{
+		const unsigned int width = 160;
+		const unsigned int height = 160;
+		TestScene<double> test;
+		Vector<double, 3> origin = { 0, 3, -1 };
+
+		std::cout << std::setw(10) << "depth" << std::setw(12) << "ms" << std::setw(16) << "samples/s" << std::setw(16) << "mean" << std::endl;
+		for (unsigned int depth : { 2u, 4u, 8u, 16u, 32u })
+		{
+			path2::ProgressiveRenderer renderer(&test.scene, origin, width, height);
+			renderer.setMaxDepth(depth);
+			auto start = Clock::now();
+			renderer.render(16);
+			double time = seconds(start);
+
+			// mittlere helligkeit, steigt mit der tiefe weil weniger pfade schwarz abgebrochen werden
+			Bitmap<unsigned char> image = renderer.getSnapshot();
+			double mean = 0;
+			for (unsigned long i = 0; i < image.getTotalSize(); i++)
+				mean += image.getData()[i];
+			mean /= image.getTotalSize();
+
+			std::cout << std::setw(10) << depth << std::setw(12) << std::fixed << std::setprecision(0) << time * 1000.0 << std::setw(16) << renderer.getSampleTotal() / time << std::setw(16) << std::setprecision(2) << mean << std::endl;
+		}
+	}
+
+	// float gegen double mit den gleichen zufallszahlen, der fehler ist klein gegen das rauschen bei gleicher sampleanzahl
+	void precision()
+	{
+		const unsigned int width = 160;
+		const unsigned int height = 160;
+		const unsigned int samples = 64;
+		TestScene<double> testDouble;
+		TestScene<float> testFloat;
+
+		path2::BasicProgressiveRenderer<double> reference(&testDouble.scene, { 0.0, 3.0, -1.0 }, width, height);
+		reference.render(1024);
+		Bitmap<unsigned char> referenceImage = reference.getSnapshot();
+
+		path2::BasicProgressiveRenderer<double> rendererDouble(&testDouble.scene, { 0.0, 3.0, -1.0 }, width, height);
+		auto start = Clock::now();
+		rendererDouble.render(samples);
+		double timeDouble = seconds(start);
+		Bitmap<unsigned char> imageDouble = rendererDouble.getSnapshot();
+
+		path2::BasicProgressiveRenderer<float> rendererFloat(&testFloat.scene, { 0.0f, 3.0f, -1.0f }, width, height);
+		start = Clock::now();
+		rendererFloat.render(samples);
+		double timeFloat = seconds(start);
+		Bitmap<unsigned char> imageFloat = rendererFloat.getSnapshot();
+
+		std::cout << std::setw(10) << "type" << std::setw(12) << "ms" << std::setw(16) << "samples/s" << std::setw(20) << "rmse to double" << std::setw(22) << "rmse to reference" << std::endl;
+		std::cout << std::setw(10) << "double" << std::setw(12) << std::fixed << std::setprecision(0) << timeDouble * 1000.0 << std::setw(16) << rendererDouble.getSampleTotal() / timeDouble
+			<< std::setw(20) << std::setprecision(2) << 0.0 << std::setw(22) << rmse(imageDouble, referenceImage) << std::endl;
+		std::cout << std::setw(10) << "float" << std::setw(12) << std::fixed << std::setprecision(0) << timeFloat * 1000.0 << std::setw(16) << rendererFloat.getSampleTotal() / timeFloat
+			<< std::setw(20) << std::setprecision(2) << rmse(imageFloat, imageDouble) << std::setw(22) << rmse(imageFloat, referenceImage) << std::endl;
+
+		// reiner strahlendurchsatz in einer grossen kugelszene, dort zaehlt die doppelte SIMD breite von float
+		auto spheres = randomSpheres(100000, 6);
+		std::vector<path2::BasicSphere<float>> spheresFloat(spheres.size());
+		path2::Scene sceneDouble;
+		path2::BasicScene<float> sceneFloat;
+		for (unsigned int i = 0; i < spheres.size(); i++)
+		{
+			spheresFloat[i].pos = { (float)spheres[i]->pos(0), (float)spheres[i]->pos(1), (float)spheres[i]->pos(2) };
+			spheresFloat[i].size = (float)spheres[i]->size;
+			spheresFloat[i].color = { 1.0f, 1.0f, 1.0f };
+			spheresFloat[i].transmission = 0.0f;
+			sceneDouble.add(spheres[i].get());
+			sceneFloat.add(&spheresFloat[i]);
+		}
+		sceneDouble.build();
+		sceneFloat.build();
+
+		auto rays = randomRays(200000, 7);
+		auto [rateDouble, countDouble] = raysPerSecond(rays, 1.0, [&](Vector<double, 3> origin, Vector<double, 3> direction)
+		{
+			path2::Hit hit;
+			path2::trace(origin, direction, sceneDouble, hit);
+		});
+		auto [rateFloat, countFloat] = raysPerSecond(rays, 1.0, [&](Vector<double, 3> origin, Vector<double, 3> direction)
+		{
+			path2::BasicHit<float> hit;
+			path2::trace<float>({ (float)origin(0), (float)origin(1), (float)origin(2) }, { (float)direction(0), (float)direction(1), (float)direction(2) }, sceneFloat, hit);
+		});
+
+		unsigned int mismatches = 0;
+		for (unsigned int i = 0; i < (std::min)(countDouble, countFloat); i++)
+		{
+			auto [origin, direction] = rays[i];
+			path2::Hit hitDouble;
+			path2::BasicHit<float> hit;
+			bool foundDouble = path2::trace(origin, direction, sceneDouble, hitDouble);
+			bool found = path2::trace<float>({ (float)origin(0), (float)origin(1), (float)origin(2) }, { (float)direction(0), (float)direction(1), (float)direction(2) }, sceneFloat, hit);
+			if (found != foundDouble || (found && std::abs(hit.distance - hitDouble.distance) > 1e-3 * (std::max)(1.0, hitDouble.distance)))
+				mismatches++;
+		}
+
+		std::cout << std::endl << std::setw(10) << "spheres" << std::setw(18) << "double rays/s" << std::setw(18) << "float rays/s" << std::setw(14) << "mismatches" << std::endl;
+		std::cout << std::setw(10) << spheres.size() << std::setw(18) << std::setprecision(0) << rateDouble << std::setw(18) << rateFloat << std::setw(14) << mismatches << std::endl;
+	}
+
+	// schreibt eine szene mit count zufaelligen kugeln und misst laden, BVH bau und einen durchgang rendern
+	// zum vergleich wird die gleiche datei einmal zeilenweise mit cg::split und std::stod gelesen
+	void sceneLoading()
+	{
+		const char* filename = "benchmark.scene";
+		const unsigned int width = 320;
+		const unsigned int height = 240;
+
+		std::cout << std::setw(10) << "spheres" << std::setw(12) << "MB" << std::setw(14) << "split ms" << std::setw(14) << "load ms" << std::setw(14) << "build ms" << std::setw(14) << "1 spp ms" << std::endl;
+		for (unsigned int count : { 10000u, 100000u, 1000000u })
+		{
+			{
+				std::FILE* file = std::fopen(filename, "wb");
+				std::fprintf(file, "resolution %u %u\nsamples 1\ncamera 0 3 -60\nmaterial weiss 1 1 1 0\nmaterial blau 0.8 0.8 1 0.4\nplane weiss\n", width, height);
+				for (auto& sphere : randomSpheres(count, count))
+					std::fprintf(file, "sphere %s %.6f %.6f %.6f %.6f\n", sphere->pos(0) > 0 ? "blau" : "weiss", sphere->pos(0), sphere->pos(1) + 50.0, sphere->pos(2), sphere->size);
+				std::fclose(file);
+			}
+
+			auto start = Clock::now();
+			{
+				std::ifstream stream(filename);
+				std::string line;
+				unsigned int values = 0;
+				while (std::getline(stream, line))
+				{
+					for (auto& token : split(line, ' '))
+					{
+						if (!token.empty() && (std::isdigit((unsigned char)token[0]) || token[0] == '-'))
+						{
+							std::stod(token);
+							values++;
+						}
+					}
+				}
+			}
+			double splitTime = seconds(start) * 1000.0;
+
+			path2::SceneFile file;
+			start = Clock::now();
+			file.load(filename);
+			double loadTime = seconds(start) * 1000.0;
+
+			start = Clock::now();
+			file.build();
+			double buildTime = seconds(start) * 1000.0;
+
+			path2::ProgressiveRenderer renderer(&file.getScene(), file.origin, file.width, file.height);
+			start = Clock::now();
+			renderer.render(file.samples);
+			double renderTime = seconds(start) * 1000.0;
+
+			std::ifstream size(filename, std::ios::binary | std::ios::ate);
+			std::cout << std::setw(10) << file.spheres.size() << std::setw(12) << std::fixed << std::setprecision(1) << size.tellg() / 1e6
+				<< std::setw(14) << std::setprecision(0) << splitTime << std::setw(14) << loadTime << std::setw(14) << buildTime << std::setw(14) << renderTime << std::endl;
+		}
+		std::remove(filename);
+	}
+
+	// kugel aus breiten- und laengengraden um (x, y, z), 2 * rings * segments dreiecke
+	MeshData sphereMesh(unsigned int rings, unsigned int segments, double radius, double x, double y, double z)
+	{
+		const double pi = 3.14159265358979323846;
+		MeshData mesh;
+		for (unsigned int i = 0; i <= rings; i++)
+		{
+			double theta = pi * i / rings;
+			for (unsigned int j = 0; j < segments; j++)
+			{
+				double phi = 2.0 * pi * j / segments;
+				mesh.vertices.push_back(float(x + radius * std::sin(theta) * std::cos(phi)));
+				mesh.vertices.push_back(float(y + radius * std::cos(theta)));
+				mesh.vertices.push_back(float(z + radius * std::sin(theta) * std::sin(phi)));
+			}
+		}
+		for (unsigned int i = 0; i < rings; i++)
+		{
+			for (unsigned int j = 0; j < segments; j++)
+			{
+				uint32_t a = i * segments + j;
+				uint32_t b = i * segments + (j + 1) % segments;
+				mesh.indices.insert(mesh.indices.end(), { a, b, b + segments, a, b + segments, a + segments });
+			}
+		}
+		return mesh;
+	}
+
+	void writeOBJ(const char* filename, const MeshData& mesh)
+	{
+		std::FILE* file = std::fopen(filename, "wb");
+		for (size_t i = 0; i < mesh.vertices.size(); i += 3)
+			std::fprintf(file, "v %.6f %.6f %.6f\n", mesh.vertices[i], mesh.vertices[i + 1], mesh.vertices[i + 2]);
+		for (size_t i = 0; i < mesh.indices.size(); i += 3)
+			std::fprintf(file, "f %u %u %u\n", mesh.indices[i] + 1, mesh.indices[i + 1] + 1, mesh.indices[i + 2] + 1);
+		std::fclose(file);
+	}
+
+	void meshLoading()
+	{
+		const char* objName = "benchmark.obj";
+		const char* meshName = "benchmark.obj.cgmesh";
+		const char* sceneName = "benchmark_mesh.scene";
+		{
+			std::FILE* file = std::fopen(sceneName, "wb");
+			std::fprintf(file, "resolution 320 240\nsamples 1\nmaterial weiss 1 1 1 0\nmaterial rot 1 0.8 0.8 0\nplane weiss\nmesh rot %s\n", objName);
+			std::fclose(file);
+		}
+
+		std::cout << std::setw(10) << "triangles" << std::setw(10) << "OBJ MB" << std::setw(12) << "import ms" << std::setw(12) << "save ms" << std::setw(12) << "mmap ms"
+			<< std::setw(12) << "build ms" << std::setw(12) << "1 spp ms" << std::setw(12) << "MRays/s" << std::endl;
+		for (unsigned int rings : { 100u, 300u, 1000u })
+		{
+			writeOBJ(objName, sphereMesh(rings, 2 * rings, 1.5, 0.0, 1.5, 6.5));
+			std::remove(meshName);
+
+			auto start = Clock::now();
+			MeshData data = importOBJ(objName);
+			double importTime = seconds(start) * 1000.0;
+
+			start = Clock::now();
+			saveMesh(meshName, data);
+			double saveTime = seconds(start) * 1000.0;
+
+			// die szene findet die aktuelle .cgmesh datei und blendet sie nur noch ein
+			path2::SceneFile file;
+			start = Clock::now();
+			file.load(sceneName);
+			double mapTime = seconds(start) * 1000.0;
+
+			start = Clock::now();
+			file.build();
+			double buildTime = seconds(start) * 1000.0;
+
+			path2::ProgressiveRenderer renderer(&file.getScene(), file.origin, file.width, file.height);
+			start = Clock::now();
+			renderer.render(file.samples);
+			double renderTime = seconds(start) * 1000.0;
+
+			// primaerstrahlen auf das netz, ohne die szene drumherum
+			path2::TriangleMesh mesh(data);
+			std::vector<std::tuple<Vector<double, 3>, Vector<double, 3>>> rays;
+			std::default_random_engine generator(rings);
+			std::uniform_real_distribution<double> random(-1.0, 1.0);
+			for (unsigned int i = 0; i < 1000000; i++)
+				rays.push_back({ Vector<double, 3>{ random(generator) * 3.0, 1.5 + random(generator) * 3.0, 0.0 }, path2::normalize(Vector<double, 3>{ random(generator) * 0.2, random(generator) * 0.2, 1.0 }) });
+			unsigned int hits = 0;
+			auto [rate, count] = raysPerSecond(rays, 2.0, [&](Vector<double, 3> origin, Vector<double, 3> direction)
+			{
+				path2::Hit hit;
+				if (mesh.intersect(origin, direction, 0.0, std::numeric_limits<double>::max(), hit))
+					hits++;
+			});
+
+			std::ifstream size(objName, std::ios::binary | std::ios::ate);
+			std::cout << std::setw(10) << data.indices.size() / 3 << std::setw(10) << std::fixed << std::setprecision(1) << size.tellg() / 1e6
+				<< std::setw(12) << std::setprecision(1) << importTime << std::setw(12) << saveTime << std::setw(12) << mapTime
+				<< std::setw(12) << buildTime << std::setw(12) << renderTime << std::setw(12) << std::setprecision(2) << rate / 1e6 << "   (" << hits << "/" << count << " hits)" << std::endl;
+		}
+		std::remove(objName);
+		std::remove(meshName);
+		std::remove(sceneName);
+	}
+
+	// wald aus count * count kopien eines netzes: einmal als instanzen eines geteilten netzes, einmal als eigene netze mit transformierten vertices
+	void instancing()
+	{
+		const unsigned int count = 16;
+		const unsigned int width = 320;
+		const unsigned int height = 240;
+		MeshData tree = sphereMesh(64, 128, 0.5, 0.0, 0.5, 0.0);
+		path2::TriangleMesh shared(tree);
+		shared.color = { 0.6, 0.9, 0.6 };
+		shared.transmission = 0.0;
+
+		std::default_random_engine generator(13);
+		std::uniform_real_distribution<double> random(0.0, 1.0);
+		std::vector<Matrix<double, 4, 4>> transforms;
+		for (unsigned int i = 0; i < count; i++)
+			for (unsigned int j = 0; j < count; j++)
+				transforms.push_back(path2::translation((i - count / 2.0) * 1.5, 0.0, 4.0 + j * 1.5) * path2::rotationY(random(generator) * 6.28) * path2::scaling(0.7 + 0.6 * random(generator)));
+
+		path2::TestPlane plane;
+		plane.color = { 1.0, 1.0, 1.0 };
+		plane.transmission = 0.0;
+
+		auto meshBytes = [](const MeshData& mesh, const path2::TriangleMesh& triangles)
+		{
+			return mesh.vertices.size() * sizeof(float) + mesh.indices.size() * sizeof(uint32_t) + triangles.getBVH().getNodes().size() * sizeof(BVHNode<double>) + triangles.getBVH().getIndices().size() * sizeof(unsigned int);
+		};
+
+		// instanzen
+		auto start = Clock::now();
+		std::vector<path2::Instance> instances;
+		instances.reserve(transforms.size());
+		for (auto& transform : transforms)
+			instances.emplace_back(&shared, transform);
+		path2::Scene instanceScene;
+		instanceScene.add(&plane);
+		for (auto& instance : instances)
+			instanceScene.add(&instance);
+		instanceScene.build();
+		double instanceBuild = seconds(start) * 1000.0;
+		size_t instanceBytes = meshBytes(tree, shared) + instances.size() * sizeof(path2::Instance);
+
+		// kopien
+		start = Clock::now();
+		std::vector<MeshData> copies;
+		for (auto& transform : transforms)
+		{
+			MeshData copy = tree;
+			for (size_t i = 0; i < copy.vertices.size(); i += 3)
+			{
+				Matrix<double, 4, 4> m = transform;
+				double x = copy.vertices[i], y = copy.vertices[i + 1], z = copy.vertices[i + 2];
+				for (unsigned int k = 0; k < 3; k++)
+					copy.vertices[i + k] = float(m(k, 0) * x + m(k, 1) * y + m(k, 2) * z + m(k, 3));
+			}
+			copies.push_back(std::move(copy));
+		}
+		std::vector<path2::TriangleMesh> meshes;
+		meshes.reserve(copies.size());
+		size_t copyBytes = 0;
+		for (auto& copy : copies)
+		{
+			meshes.emplace_back(copy);
+			meshes.back().color = shared.color;
+			meshes.back().transmission = 0.0;
+			copyBytes += meshBytes(copy, meshes.back());
+		}
+		path2::Scene copyScene;
+		copyScene.add(&plane);
+		for (auto& mesh : meshes)
+			copyScene.add(&mesh);
+		copyScene.build();
+		double copyBuild = seconds(start) * 1000.0;
+
+		path2::ProgressiveRenderer instanceRenderer(&instanceScene, { 0.0, 3.0, -1.0 }, width, height);
+		start = Clock::now();
+		instanceRenderer.render(4);
+		double instanceRender = seconds(start) * 1000.0;
+		Bitmap<unsigned char> instanceImage = instanceRenderer.getSnapshot();
+
+		path2::ProgressiveRenderer copyRenderer(&copyScene, { 0.0, 3.0, -1.0 }, width, height);
+		start = Clock::now();
+		copyRenderer.render(4);
+		double copyRender = seconds(start) * 1000.0;
+		Bitmap<unsigned char> copyImage = copyRenderer.getSnapshot();
+
+		std::cout << transforms.size() << " trees with " << tree.indices.size() / 3 << " triangles each" << std::endl;
+		std::cout << std::setw(12) << "" << std::setw(12) << "MB" << std::setw(14) << "build ms" << std::setw(14) << "4 spp ms" << std::endl;
+		std::cout << std::setw(12) << "instances" << std::setw(12) << std::fixed << std::setprecision(1) << instanceBytes / 1e6 << std::setw(14) << std::setprecision(0) << instanceBuild << std::setw(14) << instanceRender << std::endl;
+		std::cout << std::setw(12) << "copies" << std::setw(12) << std::fixed << std::setprecision(1) << copyBytes / 1e6 << std::setw(14) << std::setprecision(0) << copyBuild << std::setw(14) << copyRender << std::endl;
+		std::cout << "image RMSE instances vs copies: " << std::setprecision(3) << rmse(instanceImage, copyImage) << std::endl;
+	}
+
+	// gleiche szene, gleiche zufallszahlen: tiefe zuerst pro pixel gegen wellen ueber das ganze bild
+	template <class T>
+	void compareWavefront(const char* name, const path2::BasicScene<T>& scene, unsigned int width, unsigned int height, unsigned int samples)
+	{
+		Vector<T, 3> origin = { T(0), T(3), T(-1) };
+
+		path2::BasicProgressiveRenderer<T> progressive(&scene, origin, width, height);
+		auto start = Clock::now();
+		progressive.render(samples);
+		double progressiveTime = seconds(start) * 1000.0;
+		Bitmap<unsigned char> progressiveImage = progressive.getSnapshot();
+
+		path2::BasicWavefrontRenderer<T> wavefront(&scene, origin, width, height);
+		start = Clock::now();
+		wavefront.render(samples);
+		double wavefrontTime = seconds(start) * 1000.0;
+		Bitmap<unsigned char> wavefrontImage = wavefront.getSnapshot();
+
+		std::cout << name << ", " << width << "x" << height << ", " << samples << " spp" << std::endl;
+		std::cout << "  tracePixel " << std::fixed << std::setprecision(0) << progressiveTime << " ms, wavefront " << wavefrontTime << " ms, RMSE " << std::setprecision(3) << rmse(progressiveImage, wavefrontImage) << std::endl;
+		wavefront.printStatistics(std::cout);
+	}
+
+	void wavefront()
+	{
+		TestScene<double> test;
+		compareWavefront("test scene double", test.scene, 640, 480, 16);
+		TestScene<float> testFloat;
+		compareWavefront("test scene float", testFloat.scene, 640, 480, 16);
+
+		auto spheres = randomSpheres(100000, 14);
+		path2::Scene scene;
+		for (auto& sphere : spheres)
+			scene.add(sphere.get());
+		scene.build();
+		compareWavefront("100k spheres", scene, 320, 240, 4);
+	}
+
+	// sekundaerstrahlen unsortiert gegen blockweise nach oktant und morton code sortiert, die pfade selbst sind in beiden faellen gleich
+	void raySorting()
+	{
+		const unsigned int width = 320;
+		const unsigned int height = 240;
+		Vector<double, 3> origin = { 0, 3, -60 };
+
+		for (unsigned int count : { 100000u, 1000000u })
+		{
+			auto spheres = randomSpheres(count, count);
+			path2::TestPlane plane;
+			plane.color = { 1.0, 1.0, 1.0 };
+			plane.transmission = 0.0;
+			path2::Scene scene;
+			scene.add(&plane);
+			for (auto& sphere : spheres)
+			{
+				sphere->pos(1) += 50.0;
+				scene.add(sphere.get());
+			}
+			scene.build();
+
+			std::cout << count << " spheres, " << width << "x" << height << ", 4 spp, depth 8" << std::endl;
+			std::cout << std::setw(12) << "block" << std::setw(16) << "intersect ms" << std::setw(12) << "sort ms" << std::setw(12) << "total ms" << std::setw(10) << "RMSE" << std::endl;
+			Bitmap<unsigned char> reference;
+			for (unsigned int block : { 0u, 256u, 4096u, 65536u, width * height })
+			{
+				// die zeiten schwanken stark, es zaehlt der beste von drei laeufen
+				double intersectTime = 0, sortTime = 0, time = 0;
+				Bitmap<unsigned char> image;
+				for (unsigned int run = 0; run < 3; run++)
+				{
+					path2::WavefrontRenderer renderer(&scene, origin, width, height);
+					renderer.setMaxDepth(8);
+					renderer.setSorting(block);
+					auto start = Clock::now();
+					renderer.render(4);
+					double runTime = seconds(start) * 1000.0;
+					if (run == 0 || runTime < time)
+					{
+						time = runTime;
+						intersectTime = renderer.getStageTime(path2::WavefrontRenderer::Intersect) * 1000.0;
+						sortTime = renderer.getStageTime(path2::WavefrontRenderer::Sort) * 1000.0;
+					}
+					image = renderer.getSnapshot();
+				}
+				if (block == 0)
+					reference = image;
+
+				std::cout << std::setw(12) << block << std::setw(16) << std::fixed << std::setprecision(0) << intersectTime
+					<< std::setw(12) << sortTime << std::setw(12) << time << std::setw(10) << std::setprecision(3) << rmse(image, reference) << std::endl;
+			}
+		}
+	}
+
+	// rmse gegen eine referenz mit vielen samples, fuer steigende sampleanzahl
+	void convergence()
+	{
+		const unsigned int width = 160;
+		const unsigned int height = 120;
+		const unsigned int referenceSamples = 2048;
+		TestScene<double> test;
+		Vector<double, 3> origin = { 0, 3, -1 };
+
+		path2::ProgressiveRenderer referenceRenderer(&test.scene, origin, width, height);
+		referenceRenderer.setMaxDepth(8);
+		auto start = Clock::now();
+		referenceRenderer.render(referenceSamples);
+		std::cout << "reference " << referenceSamples << " spp in " << std::fixed << std::setprecision(1) << seconds(start) << " s" << std::endl;
+		Bitmap<unsigned char> reference = referenceRenderer.getSnapshot();
+
+		std::cout << std::setw(10) << "spp" << std::setw(12) << "ms" << std::setw(12) << "rmse" << std::endl;
+		for (unsigned int samples : { 1u, 4u, 16u, 64u, 256u })
+		{
+			path2::ProgressiveRenderer renderer(&test.scene, origin, width, height);
+			renderer.setMaxDepth(8);
+			// andere zufallszahlen als die referenz, sonst waeren die ersten samples gleich und der fehler zu klein
+			renderer.setSeed(1);
+			start = Clock::now();
+			renderer.render(samples);
+			double time = seconds(start) * 1000.0;
+			Bitmap<unsigned char> image = renderer.getSnapshot();
+			std::cout << std::setw(10) << samples << std::setw(12) << std::setprecision(0) << time << std::setw(12) << std::setprecision(2) << rmse(image, reference) << std::endl;
+		}
+	}
+
+	// rmse der mittelwerte ueber block x block pixel, zeigt wie viel vom fehler niederfrequent ist
+	double blockRmse(Bitmap<unsigned char>& a, Bitmap<unsigned char>& b, unsigned int block)
+	{
+		auto [width, height] = a.getSize();
+		double sum = 0;
+		unsigned int count = 0;
+		for (unsigned int x = 0; x + block <= width; x += block)
+		{
+			for (unsigned int y = 0; y + block <= height; y += block)
+			{
+				for (unsigned int c = 0; c < 3; c++)
+				{
+					double difference = 0;
+					for (unsigned int i = x; i < x + block; i++)
+						for (unsigned int j = y; j < y + block; j++)
+							difference += (double)a(i, j, c) - (double)b(i, j, c);
+					difference /= block * block;
+					sum += difference * difference;
+					count++;
+				}
+			}
+		}
+		return std::sqrt(sum / count);
+	}
+
+	// konvergenz der drei folgen gegen eine unabhaengige referenz mit vielen samples
+	void samplers()
+	{
+		const unsigned int width = 160;
+		const unsigned int height = 120;
+		TestScene<double> test;
+		Vector<double, 3> origin = { 0, 3, -1 };
+
+		path2::ProgressiveRenderer referenceRenderer(&test.scene, origin, width, height);
+		referenceRenderer.setSeed(1);
+		referenceRenderer.render(4096);
+		Bitmap<unsigned char> reference = referenceRenderer.getSnapshot();
+
+		const char* names[] = { "independent", "sobol", "blue noise" };
+		std::cout << std::setw(14) << "sequence" << std::setw(8) << "spp" << std::setw(10) << "ms" << std::setw(10) << "rmse" << std::setw(14) << "4x4 rmse" << std::endl;
+		for (SampleSequence sequence : { SampleSequence::Independent, SampleSequence::Sobol, SampleSequence::BlueNoise })
+		{
+			for (unsigned int samples : { 1u, 4u, 16u, 64u, 256u })
+			{
+				path2::ProgressiveRenderer renderer(&test.scene, origin, width, height);
+				renderer.setSampler(sequence);
+				auto start = Clock::now();
+				renderer.render(samples);
+				double time = seconds(start) * 1000.0;
+				Bitmap<unsigned char> image = renderer.getSnapshot();
+				std::cout << std::setw(14) << names[(int)sequence] << std::setw(8) << samples << std::setw(10) << std::fixed << std::setprecision(0) << time
+					<< std::setw(10) << std::setprecision(2) << rmse(image, reference) << std::setw(14) << blockRmse(image, reference, 4) << std::endl;
+			}
+		}
+	}
+
+	// kleine helle kugel als einzige lichtquelle in einer schwarzen kuppel, nur per zufallsrichtung gegen mit schattenstrahlen zur lampe
+	void nextEvent()
+	{
+		const unsigned int width = 160;
+		const unsigned int height = 120;
+		TestScene<double> test;
+		Vector<double, 3> origin = { 0, 3, -1 };
+
+		path2::Sphere lamp;
+		lamp.pos = { 1.5, 3.0, 5.0 };
+		lamp.size = 0.25;
+		lamp.color = { 0.0, 0.0, 0.0 };
+		lamp.transmission = 0.0;
+		lamp.emission = { 60.0, 55.0, 45.0 };
+		path2::Sphere dome;
+		dome.pos = { 0.0, 0.0, 5.0 };
+		dome.size = 50.0;
+		dome.color = { 0.0, 0.0, 0.0 };
+		dome.transmission = 0.0;
+		test.scene.add(&lamp);
+		test.scene.add(&dome);
+		test.scene.build();
+
+		path2::ProgressiveRenderer referenceRenderer(&test.scene, origin, width, height);
+		referenceRenderer.setSeed(1);
+		auto start = Clock::now();
+		referenceRenderer.render(4096);
+		std::cout << "reference 4096 spp in " << std::fixed << std::setprecision(1) << seconds(start) << " s" << std::endl;
+		Bitmap<unsigned char> reference = referenceRenderer.getSnapshot();
+
+		std::cout << std::setw(14) << "light samples" << std::setw(8) << "spp" << std::setw(10) << "ms" << std::setw(10) << "rmse" << std::endl;
+		for (bool lightSampling : { false, true })
+		{
+			test.scene.setLightSampling(lightSampling);
+			test.scene.build();
+			for (unsigned int samples : { 1u, 4u, 16u, 64u, 256u })
+			{
+				path2::ProgressiveRenderer renderer(&test.scene, origin, width, height);
+				start = Clock::now();
+				renderer.render(samples);
+				double time = seconds(start) * 1000.0;
+				Bitmap<unsigned char> image = renderer.getSnapshot();
+				std::cout << std::setw(14) << (lightSampling ? "on" : "off") << std::setw(8) << samples << std::setw(10) << std::setprecision(0) << time
+					<< std::setw(10) << std::setprecision(2) << rmse(image, reference) << std::endl;
+			}
+		}
+
+		test.scene.setLightSampling(true);
+		test.scene.build();
+		compareWavefront("lamp in dome", test.scene, 160, 120, 16);
+	}
+
+	// AO strahlen von den sichtbaren punkten aus: naechster treffer ueber tracePlus gegen occluded, unbegrenzt und mit AO radius 1
+	void compareOcclusion(const char* name, const path2::Scene& scene, Vector<double, 3> camera)
+	{
+		const unsigned int width = 160;
+		const unsigned int height = 120;
+		const unsigned int samples = 16;
+
+		std::vector<std::tuple<Vector<double, 3>, Vector<double, 3>>> rays;
+		for (unsigned int j = 0; j < height; j++)
+		{
+			for (unsigned int i = 0; i < width; i++)
+			{
+				Vector<double, 3> direction = path2::normalize(path2::getScreenPoint<double>(i, j, width, height) - camera);
+				auto [distance, object, normal, pos] = path2::tracePlus(camera, direction, scene);
+				if (object == nullptr)
+					continue;
+				for (unsigned int k = 0; k < samples; k++)
+				{
+					Random random(j * width + i, k);
+					rays.push_back({ pos, path2::randomHemisphere(normal, random) });
+				}
+			}
+		}
+
+		for (double tmax : { std::numeric_limits<double>::max(), 1.0 })
+		{
+			std::vector<unsigned char> reference;
+			unsigned int blocked = 0;
+			auto [closestRate, closestCount] = raysPerSecond(rays, 2.0, [&](Vector<double, 3> origin, Vector<double, 3> direction)
+			{
+				auto [distance, object, normal, pos] = path2::tracePlus(origin, direction, scene);
+				reference.push_back(object != nullptr && distance < tmax);
+				blocked += reference.back();
+			});
+			unsigned int mismatches = 0;
+			unsigned int index = 0;
+			auto [anyRate, anyCount] = raysPerSecond(rays, 2.0, [&](Vector<double, 3> origin, Vector<double, 3> direction)
+			{
+				bool hit = path2::occluded(origin, direction, scene, tmax);
+				if (index < reference.size() && hit != (reference[index] != 0))
+					mismatches++;
+				index++;
+			});
+			std::cout << std::setw(16) << name << std::setw(8) << (tmax == 1.0 ? "1" : "inf") << std::setw(10) << std::fixed << std::setprecision(0) << 100.0 * blocked / closestCount << "%"
+				<< std::setw(16) << std::setprecision(2) << closestRate / 1e6 << std::setw(16) << anyRate / 1e6 << std::setw(10) << anyRate / closestRate << std::setw(12) << mismatches << std::endl;
+		}
+	}
+
+	void occlusion()
+	{
+		std::cout << std::setw(16) << "scene" << std::setw(8) << "tmax" << std::setw(11) << "blocked" << std::setw(16) << "tracePlus Mr/s" << std::setw(16) << "occluded Mr/s" << std::setw(10) << "speedup" << std::setw(12) << "mismatches" << std::endl;
+
+		TestScene<double> test;
+		compareOcclusion("test scene", test.scene, { 0.0, 3.0, -1.0 });
+
+		auto spheres = randomSpheres(100000, 14);
+		path2::Scene sphereScene;
+		for (auto& sphere : spheres)
+			sphereScene.add(sphere.get());
+		sphereScene.build();
+		compareOcclusion("100k spheres", sphereScene, { 0.0, 3.0, -60.0 });
+
+		// wald aus instanzen wie in instancing(), hier zaehlt der abbruch im ersten blatt der dreiecks-BVH
+		MeshData tree = sphereMesh(64, 128, 0.5, 0.0, 0.5, 0.0);
+		path2::TriangleMesh shared(tree);
+		std::default_random_engine generator(13);
+		std::uniform_real_distribution<double> random(0.0, 1.0);
+		std::vector<path2::Instance> instances;
+		instances.reserve(16 * 16);
+		for (unsigned int i = 0; i < 16; i++)
+			for (unsigned int j = 0; j < 16; j++)
+				instances.emplace_back(&shared, path2::translation((i - 8.0) * 1.5, 0.0, 4.0 + j * 1.5) * path2::rotationY(random(generator) * 6.28) * path2::scaling(0.7 + 0.6 * random(generator)));
+		path2::TestPlane plane;
+		path2::Scene forest;
+		forest.add(&plane);
+		for (auto& instance : instances)
+			forest.add(&instance);
+		forest.build();
+		compareOcclusion("instances", forest, { 0.0, 3.0, -1.0 });
+	}
+
+	// indirektes licht: eine schwarze kugel verdeckt die lampe nach unten, die szene sieht nur den hellen fleck, den die lampe auf eine weisse kugel darueber wirft
+	// die kosinusverteilung trifft diesen fleck selten, gleiche rechenzeit mit und ohne guiding, die trainingsdurchgaenge zaehlen mit
+	void pathGuiding()
+	{
+		const unsigned int width = 160;
+		const unsigned int height = 120;
+		TestScene<double> test;
+		Vector<double, 3> origin = { 0, 3, -1 };
+
+		path2::Sphere lamp;
+		lamp.pos = { 0.0, 5.5, 6.0 };
+		lamp.size = 0.2;
+		lamp.color = { 0.0, 0.0, 0.0 };
+		lamp.transmission = 0.0;
+		lamp.emission = { 1500.0, 1425.0, 1275.0 };
+		path2::Sphere shade;
+		shade.pos = { 0.0, 4.3, 6.0 };
+		shade.size = 1.0;
+		shade.color = { 0.0, 0.0, 0.0 };
+		shade.transmission = 0.0;
+		path2::Sphere reflector;
+		reflector.pos = { 0.0, 7.3, 6.0 };
+		reflector.size = 1.0;
+		reflector.color = { 1.0, 1.0, 1.0 };
+		reflector.transmission = 0.0;
+		path2::Sphere dome;
+		dome.pos = { 0.0, 0.0, 6.0 };
+		dome.size = 10.0;
+		dome.color = { 0.0, 0.0, 0.0 };
+		dome.transmission = 0.0;
+		test.scene.add(&lamp);
+		test.scene.add(&shade);
+		test.scene.add(&reflector);
+		test.scene.add(&dome);
+		test.scene.build();
+
+		path2::ProgressiveRenderer referenceRenderer(&test.scene, origin, width, height);
+		referenceRenderer.setMaxDepth(6);
+		referenceRenderer.setSeed(1);
+		auto start = Clock::now();
+		referenceRenderer.render(4096);
+		std::cout << "reference 4096 spp in " << std::fixed << std::setprecision(1) << seconds(start) << " s" << std::endl;
+		Bitmap<unsigned char> reference = referenceRenderer.getSnapshot();
+
+		std::cout << std::setw(10) << "guiding" << std::setw(10) << "seconds" << std::setw(8) << "spp" << std::setw(10) << "rmse" << std::setw(14) << "4x4 rmse" << std::endl;
+		for (bool guided : { false, true })
+		{
+			for (double budget : { 2.0, 4.0, 8.0, 16.0 })
+			{
+				path2::ProgressiveRenderer renderer(&test.scene, origin, width, height);
+				renderer.setMaxDepth(6);
+				if (guided)
+					renderer.setGuiding(7);
+				renderer.render(1000000, budget);
+				Bitmap<unsigned char> image = renderer.getSnapshot();
+				std::cout << std::setw(10) << (guided ? "on" : "off") << std::setw(10) << std::setprecision(0) << budget << std::setw(8) << renderer.getPassCount()
+					<< std::setw(10) << std::setprecision(2) << rmse(image, reference) << std::setw(14) << blockRmse(image, reference, 4) << std::endl;
+				if (guided && budget == 16.0)
+					std::cout << "  " << renderer.getGuide()->getRegionCount() << " regions, " << renderer.getGuide()->getDirectionNodeCount() << " direction nodes" << std::endl;
+			}
+		}
+	}
+
+	// balancierter baum aus weichen vereinigungen, die knoten landen in storage
+	const path2::DistanceFunction* smoothTree(const std::vector<const path2::DistanceFunction*>& leaves, unsigned int begin, unsigned int end, double k, std::vector<std::unique_ptr<path2::DistanceFunction>>& storage)
+	{
+		if (end - begin == 1)
+			return leaves[begin];
+		unsigned int middle = (begin + end) / 2;
+		storage.push_back(std::make_unique<path2::SmoothUnion>(smoothTree(leaves, begin, middle, k, storage), smoothTree(leaves, middle, end, k, storage), k));
+		return storage.back().get();
+	}
+
+	// kamerastrahlen durch ein einzelnes abstandsobjekt mit und ohne ueberrelaxation, treffer muessen uebereinstimmen
+	void compareRelaxation(const char* name, const path2::DistanceFunction* function, Vector<double, 3> camera)
+	{
+		const unsigned int width = 320;
+		const unsigned int height = 240;
+		std::vector<std::tuple<Vector<double, 3>, Vector<double, 3>>> rays;
+		for (unsigned int j = 0; j < height; j++)
+			for (unsigned int i = 0; i < width; i++)
+				rays.push_back({ camera, path2::normalize(path2::getScreenPoint<double>(i, j, width, height) - camera) });
+
+		std::vector<double> reference;
+		unsigned int hits = 0;
+		double referenceRate = 0;
+		for (double omega : { 1.0, 1.3, 1.6, 1.9 })
+		{
+			path2::DistanceObject object(function, omega);
+			unsigned int mismatches = 0;
+			double maxError = 0;
+			unsigned int index = 0;
+			auto [rate, count] = raysPerSecond(rays, 2.0, [&](Vector<double, 3> origin, Vector<double, 3> direction)
+			{
+				path2::Hit hit;
+				double distance = object.intersect(origin, direction, 0.0, std::numeric_limits<double>::max(), hit) ? hit.distance : -1.0;
+				if (omega == 1.0)
+				{
+					reference.push_back(distance);
+					hits += distance >= 0;
+				}
+				else if (index < reference.size())
+				{
+					// streifende strahlen duerfen innerhalb der genauigkeit an einer kante vorbeigehen und weiter hinten treffen
+					if ((distance >= 0) != (reference[index] >= 0) || (distance >= 0 && std::abs(distance - reference[index]) > 1e-3 * reference[index]))
+						mismatches++;
+					else if (distance >= 0)
+						maxError = (std::max)(maxError, std::abs(distance - reference[index]));
+				}
+				index++;
+			});
+			if (omega == 1.0)
+				referenceRate = rate;
+			std::cout << std::setw(12) << name << std::setw(8) << std::fixed << std::setprecision(1) << omega << std::setw(10) << std::setprecision(0) << 100.0 * hits / reference.size() << "%"
+				<< std::setw(12) << std::setprecision(3) << rate / 1e6 << std::setw(10) << std::setprecision(2) << rate / referenceRate << std::setw(12) << mismatches << std::setw(12) << std::scientific << std::setprecision(1) << maxError << std::endl;
+		}
+	}
+
+	void distanceFields()
+	{
+		// gleiche szene einmal analytisch und einmal als abstandsfunktionen, die bilder muessen bis auf kanten gleich sein
+		{
+			TestScene<double> test;
+			path2::DistanceSphere sphere({ 0.15, 1.0, 6.5 }, 1.0);
+			path2::DistanceSphere sphere2({ -1.0, 0.75, 5.1 }, 0.75);
+			path2::DistanceSphere sphere3({ 0.5, 0.5, 5.0 }, 0.5);
+			path2::DistanceObject object(&sphere), object2(&sphere2), object3(&sphere3);
+			path2::DistanceObject* objects[3] = { &object, &object2, &object3 };
+			path2::Sphere* analytic[3] = { &test.sphere, &test.sphere2, &test.sphere3 };
+			path2::Scene scene;
+			scene.add(&test.plane);
+			for (unsigned int i = 0; i < 3; i++)
+			{
+				objects[i]->color = analytic[i]->color;
+				objects[i]->transmission = analytic[i]->transmission;
+				scene.add(objects[i]);
+			}
+			scene.build();
+
+			path2::ProgressiveRenderer referenceRenderer(&test.scene, { 0, 3, -1 }, 320, 240);
+			referenceRenderer.render(16);
+			Bitmap<unsigned char> reference = referenceRenderer.getSnapshot();
+			path2::ProgressiveRenderer renderer(&scene, { 0, 3, -1 }, 320, 240);
+			auto start = Clock::now();
+			renderer.render(16);
+			double elapsed = seconds(start);
+			Bitmap<unsigned char> image = renderer.getSnapshot();
+			std::cout << "test scene as distance functions: 16 spp in " << std::fixed << std::setprecision(2) << elapsed << " s, rmse " << rmse(image, reference) << std::endl;
+		}
+
+		std::cout << std::setw(12) << "function" << std::setw(8) << "omega" << std::setw(11) << "hits" << std::setw(12) << "Mrays/s" << std::setw(10) << "speedup" << std::setw(12) << "mismatches" << std::setw(12) << "max error" << std::endl;
+
+		std::default_random_engine generator(17);
+		std::uniform_real_distribution<double> random(0.0, 1.0);
+		std::vector<std::unique_ptr<path2::DistanceFunction>> storage;
+
+		// weiche kugeln auf einer tafel mit loechern, darum ein ring
+		std::vector<const path2::DistanceFunction*> blobs;
+		for (unsigned int i = 0; i < 32; i++)
+		{
+			storage.push_back(std::make_unique<path2::DistanceSphere>(Vector<double, 3>{ random(generator) * 3.0 - 1.5, 0.3 + random(generator) * 1.5, 5.0 + random(generator) * 3.0 }, 0.2 + random(generator) * 0.3));
+			blobs.push_back(storage.back().get());
+		}
+		const path2::DistanceFunction* blob = smoothTree(blobs, 0, static_cast<unsigned int>(blobs.size()), 0.3, storage);
+		path2::DistanceBox slab({ 0.0, 0.1, 6.5 }, { 2.5, 0.1, 2.5 });
+		std::vector<const path2::DistanceFunction*> holes;
+		for (unsigned int i = 0; i < 8; i++)
+		{
+			for (unsigned int j = 0; j < 8; j++)
+			{
+				storage.push_back(std::make_unique<path2::DistanceSphere>(Vector<double, 3>{ -2.2 + i * 0.63, 0.1, 4.2 + j * 0.63 }, 0.2));
+				holes.push_back(storage.back().get());
+			}
+		}
+		path2::DistanceSubtraction plate(&slab, path2::buildUnion(holes, storage));
+		path2::DistanceTorus ring({ 0.0, 0.5, 6.5 }, 2.8, 0.2);
+		path2::SmoothUnion blobPlate(blob, &plate, 0.2);
+		path2::DistanceUnion csg(&blobPlate, &ring);
+		compareRelaxation("csg", &csg, { 0.0, 3.0, -1.0 });
+
+		// flacher blick ueber eine grosse gelochte platte, die strahlen laufen lange dicht an der oberflaeche entlang
+		path2::DistanceBox floor({ 0.0, 2.4, 30.0 }, { 20.0, 0.1, 30.0 });
+		std::vector<const path2::DistanceFunction*> pits;
+		for (unsigned int i = 0; i < 1024; i++)
+		{
+			storage.push_back(std::make_unique<path2::DistanceSphere>(Vector<double, 3>{ random(generator) * 40.0 - 20.0, 2.5, random(generator) * 60.0 }, 0.1 + random(generator) * 0.4));
+			pits.push_back(storage.back().get());
+		}
+		path2::DistanceSubtraction pitted(&floor, path2::buildUnion(pits, storage));
+		compareRelaxation("grazing", &pitted, { 0.0, 2.8, -1.0 });
+
+		// viele kleine kugeln in einem baum aus vereinigungen, die boxen ersparen fast alle auswertungen
+		std::vector<const path2::DistanceFunction*> grains;
+		for (unsigned int i = 0; i < 4096; i++)
+		{
+			storage.push_back(std::make_unique<path2::DistanceSphere>(Vector<double, 3>{ random(generator) * 6.0 - 3.0, random(generator) * 3.0, 4.0 + random(generator) * 6.0 }, 0.03 + random(generator) * 0.05));
+			grains.push_back(storage.back().get());
+		}
+		const path2::DistanceFunction* grainTree = path2::buildUnion(grains, storage);
+		compareRelaxation("4096 grains", grainTree, { 0.0, 3.0, -1.0 });
+	}
+}
+
+int main7()
+{
+	benchmark::bvh();
+
+	return 0;
+}
+
+int main8()
+{
+	benchmark::allocations();
+
+	return 0;
+}
+
+int main9()
+{
+	benchmark::sphereKernel();
+
+	return 0;
+}
+
+int main10()
+{
+	benchmark::adaptiveSampling();
+
+	return 0;
+}
+
+int main11()
+{
+	benchmark::pathDepth();
+
+	return 0;
+}
+
+int main12()
+{
+	benchmark::precision();
+
+	return 0;
+}
+
+int main14()
+{
+	benchmark::sceneLoading();
+
+	return 0;
+}
+
+int main15()
+{
+	benchmark::meshLoading();
+
+	return 0;
+}
+
+int main16()
+{
+	benchmark::instancing();
+
+	return 0;
+}
+
+int main17()
+{
+	benchmark::wavefront();
+
+	return 0;
+}
+
+int main18()
+{
+	benchmark::raySorting();
+
+	return 0;
+}
+
+int main19()
+{
+	benchmark::convergence();
+
+	return 0;
+}
+
+int main20()
+{
+	benchmark::samplers();
+
+	return 0;
+}
+
+int main21()
+{
+	benchmark::nextEvent();
+
+	return 0;
+}
+
+int main22()
+{
+	benchmark::occlusion();
+
+	return 0;
+}
+
+int main23()
+{
+	benchmark::pathGuiding();
+
+	return 0;
+}
+
+int main24()
+{
+	benchmark::distanceFields();
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,474 @@
+#pragma once
+
+#include "PathTracing2.h"
+#include "BVH.h"
+
+#include <vector>
+#include <memory>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+namespace path2
+{
+	// vorzeichenbehafteter abstand zur oberflaeche, innen negativ
+	// getLipschitz ist eine obere schranke fuer |grad f|: um einen punkt liegt im radius |f| / L sicher keine oberflaeche
+	// getBounds muss die ganze oberflaeche enthalten, ausserhalb wird nicht marschiert
+	template <class T>
+	class BasicDistanceFunction
+	{
+	public:
+		virtual ~BasicDistanceFunction() = default;
+		virtual T distance(Vector<T, 3> point) const = 0;
+		// wie distance, aber ein ergebnis ab limit muss nicht genau sein, nur zwischen limit und dem wahren abstand liegen
+		virtual T boundedDistance(Vector<T, 3> point, T limit) const { return distance(point); };
+		virtual AABB<T> getBounds() const = 0;
+		virtual T getLipschitz() const { return T(1); };
+	};
+
+	template <class T>
+	class BasicDistanceSphere : public BasicDistanceFunction<T>
+	{
+	public:
+		BasicDistanceSphere(Vector<T, 3> center, T radius);
+		T distance(Vector<T, 3> point) const;
+		AABB<T> getBounds() const;
+	private:
+		Vector<T, 3> center;
+		T radius;
+	};
+
+	template <class T>
+	class BasicDistanceBox : public BasicDistanceFunction<T>
+	{
+	public:
+		BasicDistanceBox(Vector<T, 3> center, Vector<T, 3> halfSize);
+		T distance(Vector<T, 3> point) const;
+		AABB<T> getBounds() const;
+	private:
+		Vector<T, 3> center;
+		Vector<T, 3> halfSize;
+	};
+
+	// ring um die y-achse
+	template <class T>
+	class BasicDistanceTorus : public BasicDistanceFunction<T>
+	{
+	public:
+		BasicDistanceTorus(Vector<T, 3> center, T majorRadius, T minorRadius);
+		T distance(Vector<T, 3> point) const;
+		AABB<T> getBounds() const;
+	private:
+		Vector<T, 3> center;
+		T majorRadius;
+		T minorRadius;
+	};
+
+	// CSG knoten halten nur zeiger, die operanden muessen so lange leben wie der knoten
+	// min(a, b), ein operand wird nur ausgewertet wenn seine box naeher liegt als der bisher kleinste abstand
+	template <class T>
+	class BasicDistanceUnion : public BasicDistanceFunction<T>
+	{
+	public:
+		BasicDistanceUnion(const BasicDistanceFunction<T>* a, const BasicDistanceFunction<T>* b);
+		T distance(Vector<T, 3> point) const;
+		T boundedDistance(Vector<T, 3> point, T limit) const;
+		AABB<T> getBounds() const;
+		T getLipschitz() const;
+	private:
+		const BasicDistanceFunction<T>* a;
+		const BasicDistanceFunction<T>* b;
+		AABB<T> boundsA, boundsB;
+	};
+
+	// polynomielles smooth-min mit uebergangsbreite k, der gradient ist eine konvexkombination der beiden, L bleibt max(La, Lb)
+	// die oberflaeche waechst dabei um hoechstens k / 4 ueber beide hinaus
+	template <class T>
+	class BasicSmoothUnion : public BasicDistanceFunction<T>
+	{
+	public:
+		BasicSmoothUnion(const BasicDistanceFunction<T>* a, const BasicDistanceFunction<T>* b, T k);
+		T distance(Vector<T, 3> point) const;
+		AABB<T> getBounds() const;
+		T getLipschitz() const;
+	private:
+		const BasicDistanceFunction<T>* a;
+		const BasicDistanceFunction<T>* b;
+		T k;
+	};
+
+	// a ohne b: max(a, -b)
+	template <class T>
+	class BasicDistanceSubtraction : public BasicDistanceFunction<T>
+	{
+	public:
+		BasicDistanceSubtraction(const BasicDistanceFunction<T>* a, const BasicDistanceFunction<T>* b);
+		T distance(Vector<T, 3> point) const;
+		AABB<T> getBounds() const;
+		T getLipschitz() const;
+	private:
+		const BasicDistanceFunction<T>* a;
+		const BasicDistanceFunction<T>* b;
+	};
+
+	// objekt der szene aus einer abstandsfunktion, geschnitten mit sphere tracing (Hart 1996)
+	// der strahl wird zuerst auf die box der funktion gekuerzt, in der szene liegt das objekt ausserdem in der BVH
+	// mit ueberrelaxation (Keinert et al. 2014) wird jeder schritt um overRelaxation verlaengert, solange sich die sicheren kugeln
+	// zweier punkte ueberlappen, sonst geht es zum letzten punkt zurueck und ohne ueberrelaxation weiter
+	// die box wird im konstruktor gelesen, nach aenderungen an der funktion muss das objekt neu erzeugt werden
+	template <class T>
+	class BasicDistanceObject : public BasicRayTraceObject<T>
+	{
+	public:
+		// overRelaxation 1 ist einfaches sphere tracing, sinnvoll sind werte bis etwa 1.8
+		// lohnt sich nur bei langen wegen dicht an flachen oberflaechen, nach dem kuerzen auf die box sind die wege meist kurz (siehe main24)
+		BasicDistanceObject(const BasicDistanceFunction<T>* function, T overRelaxation = T(1), unsigned int maxSteps = 256);
+
+		bool intersect(Vector<T, 3> origin, Vector<T, 3> direction, T tmin, T tmax, BasicHit<T>& hit);
+		bool occluded(Vector<T, 3> origin, Vector<T, 3> direction, T tmin, T tmax);
+		bool getBounds(AABB<T>& bounds);
+		// gradient ueber vier punkte eines tetraeders, fuer abstandsfunktionen ungefaehr normiert
+		Vector<T, 3> getNormal(Vector<T, 3> point) const;
+		const BasicDistanceFunction<T>* getFunction() const;
+	private:
+		bool march(Vector<T, 3> origin, Vector<T, 3> direction, T tmin, T tmax, T& t) const;
+
+		const BasicDistanceFunction<T>* function;
+		AABB<T> bounds;
+		T overRelaxation;
+		unsigned int maxSteps;
+		// ab diesem abstand gilt die oberflaeche als getroffen, groesser als der versatz nach einem treffer
+		T precision;
+	};
+
+	using DistanceFunction = BasicDistanceFunction<double>;
+	using DistanceSphere = BasicDistanceSphere<double>;
+	using DistanceBox = BasicDistanceBox<double>;
+	using DistanceTorus = BasicDistanceTorus<double>;
+	using DistanceUnion = BasicDistanceUnion<double>;
+	using SmoothUnion = BasicSmoothUnion<double>;
+	using DistanceSubtraction = BasicDistanceSubtraction<double>;
+	using DistanceObject = BasicDistanceObject<double>;
+
+	// abstand eines punkts zu einer box, 0 innerhalb
+	template <class T>
+	T boxDistance(AABB<T> box, Vector<T, 3> point);
+	// vereinigung vieler funktionen als balancierter baum, wie in der BVH jeweils am median der laengsten achse geteilt
+	// so bleiben die boxen der teilbaeume klein und eine auswertung steigt nur in die naechsten ab
+	// die inneren knoten kommen nach nodes und muessen so lange leben wie die wurzel
+	template <class T>
+	const BasicDistanceFunction<T>* buildUnion(std::vector<const BasicDistanceFunction<T>*> functions, std::vector<std::unique_ptr<BasicDistanceFunction<T>>>& nodes);
+
+	// impl ---------------------------------
+
+	template<class T>
+	inline T boxDistance(AABB<T> box, Vector<T, 3> point)
+	{
+		T sum = 0;
+		for (unsigned int i = 0; i < 3; i++)
+		{
+			T outside = (std::max)((std::max)(box.min(i) - point(i), point(i) - box.max(i)), T(0));
+			sum += outside * outside;
+		}
+		return std::sqrt(sum);
+	}
+
+	template<class T>
+	inline const BasicDistanceFunction<T>* buildUnion(std::vector<const BasicDistanceFunction<T>*> functions, std::vector<std::unique_ptr<BasicDistanceFunction<T>>>& nodes)
+	{
+		if (functions.empty())
+			return nullptr;
+		if (functions.size() == 1)
+			return functions[0];
+
+		AABB<T> centers;
+		for (auto function : functions)
+			centers.extend(function->getBounds().getCenter());
+		unsigned int axis = 0;
+		for (unsigned int i = 1; i < 3; i++)
+			if (centers.max(i) - centers.min(i) > centers.max(axis) - centers.min(axis))
+				axis = i;
+
+		auto middle = functions.begin() + functions.size() / 2;
+		std::nth_element(functions.begin(), middle, functions.end(), [axis](const BasicDistanceFunction<T>* a, const BasicDistanceFunction<T>* b)
+		{
+			return a->getBounds().getCenter()(axis) < b->getBounds().getCenter()(axis);
+		});
+		const BasicDistanceFunction<T>* left = buildUnion(std::vector<const BasicDistanceFunction<T>*>(functions.begin(), middle), nodes);
+		const BasicDistanceFunction<T>* right = buildUnion(std::vector<const BasicDistanceFunction<T>*>(middle, functions.end()), nodes);
+		nodes.push_back(std::make_unique<BasicDistanceUnion<T>>(left, right));
+		return nodes.back().get();
+	}
+
+	template<class T>
+	inline BasicDistanceSphere<T>::BasicDistanceSphere(Vector<T, 3> center, T radius) : center(center), radius(radius)
+	{
+	}
+
+	template<class T>
+	inline T BasicDistanceSphere<T>::distance(Vector<T, 3> point) const
+	{
+		Vector<T, 3> offset = point - center;
+		return std::sqrt(offset * offset) - radius;
+	}
+
+	template<class T>
+	inline AABB<T> BasicDistanceSphere<T>::getBounds() const
+	{
+		Vector<T, 3> c = center;
+		return AABB<T>({ c(0) - radius, c(1) - radius, c(2) - radius }, { c(0) + radius, c(1) + radius, c(2) + radius });
+	}
+
+	template<class T>
+	inline BasicDistanceBox<T>::BasicDistanceBox(Vector<T, 3> center, Vector<T, 3> halfSize) : center(center), halfSize(halfSize)
+	{
+	}
+
+	template<class T>
+	inline T BasicDistanceBox<T>::distance(Vector<T, 3> point) const
+	{
+		Vector<T, 3> c = center;
+		Vector<T, 3> h = halfSize;
+		T outside = 0;
+		T inside = -std::numeric_limits<T>::max();
+		for (unsigned int i = 0; i < 3; i++)
+		{
+			T q = std::abs(point(i) - c(i)) - h(i);
+			outside += q > 0 ? q * q : T(0);
+			inside = (std::max)(inside, q);
+		}
+		return std::sqrt(outside) + (std::min)(inside, T(0));
+	}
+
+	template<class T>
+	inline AABB<T> BasicDistanceBox<T>::getBounds() const
+	{
+		Vector<T, 3> c = center;
+		Vector<T, 3> h = halfSize;
+		return AABB<T>(c - h, c + h);
+	}
+
+	template<class T>
+	inline BasicDistanceTorus<T>::BasicDistanceTorus(Vector<T, 3> center, T majorRadius, T minorRadius) : center(center), majorRadius(majorRadius), minorRadius(minorRadius)
+	{
+	}
+
+	template<class T>
+	inline T BasicDistanceTorus<T>::distance(Vector<T, 3> point) const
+	{
+		Vector<T, 3> p = point - center;
+		T ring = std::sqrt(p(0) * p(0) + p(2) * p(2)) - majorRadius;
+		return std::sqrt(ring * ring + p(1) * p(1)) - minorRadius;
+	}
+
+	template<class T>
+	inline AABB<T> BasicDistanceTorus<T>::getBounds() const
+	{
+		Vector<T, 3> c = center;
+		T r = majorRadius + minorRadius;
+		return AABB<T>({ c(0) - r, c(1) - minorRadius, c(2) - r }, { c(0) + r, c(1) + minorRadius, c(2) + r });
+	}
+
+	template<class T>
+	inline BasicDistanceUnion<T>::BasicDistanceUnion(const BasicDistanceFunction<T>* a, const BasicDistanceFunction<T>* b) : a(a), b(b), boundsA(a->getBounds()), boundsB(b->getBounds())
+	{
+	}
+
+	template<class T>
+	inline T BasicDistanceUnion<T>::distance(Vector<T, 3> point) const
+	{
+		return boundedDistance(point, std::numeric_limits<T>::infinity());
+	}
+
+	template<class T>
+	inline T BasicDistanceUnion<T>::boundedDistance(Vector<T, 3> point, T limit) const
+	{
+		// wie die suche nach dem naechsten nachbarn: die naehere box zuerst, die andere faellt weg, wenn ihre box schon weiter
+		// weg ist als das bisher beste ergebnis, weil ihre oberflaeche mindestens so weit weg ist wie die box
+		T nearA = boxDistance(boundsA, point);
+		T nearB = boxDistance(boundsB, point);
+		const BasicDistanceFunction<T>* first = nearA <= nearB ? a : b;
+		const BasicDistanceFunction<T>* second = nearA <= nearB ? b : a;
+		T nearFirst = (std::min)(nearA, nearB);
+		T nearSecond = (std::max)(nearA, nearB);
+		if (nearFirst >= limit)
+			return nearFirst;
+		T result = first->boundedDistance(point, limit);
+		limit = (std::min)(limit, result);
+		if (nearSecond < limit)
+			result = (std::min)(result, second->boundedDistance(point, limit));
+		return result;
+	}
+
+	template<class T>
+	inline AABB<T> BasicDistanceUnion<T>::getBounds() const
+	{
+		AABB<T> bounds = boundsA;
+		bounds.extend(boundsB);
+		return bounds;
+	}
+
+	template<class T>
+	inline T BasicDistanceUnion<T>::getLipschitz() const
+	{
+		return (std::max)(a->getLipschitz(), b->getLipschitz());
+	}
+
+	template<class T>
+	inline BasicSmoothUnion<T>::BasicSmoothUnion(const BasicDistanceFunction<T>* a, const BasicDistanceFunction<T>* b, T k) : a(a), b(b), k(k)
+	{
+	}
+
+	template<class T>
+	inline T BasicSmoothUnion<T>::distance(Vector<T, 3> point) const
+	{
+		T da = a->distance(point);
+		T db = b->distance(point);
+		T h = (std::min)((std::max)(T(0.5) + T(0.5) * (db - da) / k, T(0)), T(1));
+		return db + (da - db) * h - k * h * (T(1) - h);
+	}
+
+	template<class T>
+	inline AABB<T> BasicSmoothUnion<T>::getBounds() const
+	{
+		AABB<T> bounds = a->getBounds();
+		bounds.extend(b->getBounds());
+		T grow = k / T(4);
+		return AABB<T>(bounds.min - Vector<T, 3>{ grow, grow, grow }, bounds.max + Vector<T, 3>{ grow, grow, grow });
+	}
+
+	template<class T>
+	inline T BasicSmoothUnion<T>::getLipschitz() const
+	{
+		return (std::max)(a->getLipschitz(), b->getLipschitz());
+	}
+
+	template<class T>
+	inline BasicDistanceSubtraction<T>::BasicDistanceSubtraction(const BasicDistanceFunction<T>* a, const BasicDistanceFunction<T>* b) : a(a), b(b)
+	{
+	}
+
+	template<class T>
+	inline T BasicDistanceSubtraction<T>::distance(Vector<T, 3> point) const
+	{
+		return (std::max)(a->distance(point), -b->distance(point));
+	}
+
+	template<class T>
+	inline AABB<T> BasicDistanceSubtraction<T>::getBounds() const
+	{
+		return a->getBounds();
+	}
+
+	template<class T>
+	inline T BasicDistanceSubtraction<T>::getLipschitz() const
+	{
+		return (std::max)(a->getLipschitz(), b->getLipschitz());
+	}
+
+	template<class T>
+	inline BasicDistanceObject<T>::BasicDistanceObject(const BasicDistanceFunction<T>* function, T overRelaxation, unsigned int maxSteps)
+		: function(function), bounds(function->getBounds()), overRelaxation(overRelaxation), maxSteps(maxSteps), precision(getRayOffset<T>() * T(10))
+	{
+	}
+
+	template<class T>
+	inline bool BasicDistanceObject<T>::march(Vector<T, 3> origin, Vector<T, 3> direction, T tmin, T tmax, T& t) const
+	{
+		// strahl auf die box kuerzen
+		T start = tmin;
+		AABB<T> box = bounds;
+		for (unsigned int i = 0; i < 3; i++)
+		{
+			T inverse = T(1) / direction(i);
+			T t0 = (box.min(i) - origin(i)) * inverse;
+			T t1 = (box.max(i) - origin(i)) * inverse;
+			if (t0 > t1)
+				std::swap(t0, t1);
+			tmin = (std::max)(tmin, t0);
+			tmax = (std::min)(tmax, t1);
+		}
+		if (!(tmin <= tmax))
+			return false;
+
+		// abstaende in einheiten von t, die richtung muss nicht normiert sein (z.b. aus einer Instance)
+		T length = std::sqrt(direction * direction);
+		T scale = T(1) / (function->getLipschitz() * length);
+		T omega = overRelaxation;
+		T step = 0;
+		T previous = 0;
+		t = tmin;
+		// ein strahl, der auf der oberflaeche startet (nach einem treffer), muss sich erst von ihr loesen
+		// wer erst am rand der box einsteigt, kommt von aussen und darf die oberflaeche dort treffen
+		bool leaving = t == start && std::abs(function->distance(origin + direction * t)) < precision * T(2);
+		for (unsigned int i = 0; i < maxSteps && t <= tmax; i++)
+		{
+			T distance = std::abs(function->distance(origin + direction * t));
+			T radius = distance * scale;
+			if (omega > T(1) && radius + previous < step)
+			{
+				// die sicheren kugeln ueberlappen nicht, dazwischen kann eine oberflaeche liegen
+				t += previous - step;
+				step = previous;
+				omega = T(1);
+				continue;
+			}
+			if (leaving)
+			{
+				leaving = distance < precision * T(2);
+				radius = (std::max)(radius, precision / length);
+			}
+			else if (distance < precision)
+				return true;
+			previous = radius;
+			step = radius * omega;
+			t += step;
+		}
+		return false;
+	}
+
+	template<class T>
+	inline bool BasicDistanceObject<T>::intersect(Vector<T, 3> origin, Vector<T, 3> direction, T tmin, T tmax, BasicHit<T>& hit)
+	{
+		T t;
+		if (!march(origin, direction, tmin, tmax, t) || t <= tmin || t >= tmax)
+			return false;
+		hit = { t, this, getNormal(origin + direction * t) };
+		return true;
+	}
+
+	template<class T>
+	inline bool BasicDistanceObject<T>::occluded(Vector<T, 3> origin, Vector<T, 3> direction, T tmin, T tmax)
+	{
+		T t;
+		return march(origin, direction, tmin, tmax, t) && t > tmin && t < tmax;
+	}
+
+	template<class T>
+	inline bool BasicDistanceObject<T>::getBounds(AABB<T>& bounds)
+	{
+		bounds = this->bounds;
+		return true;
+	}
+
+	template<class T>
+	inline Vector<T, 3> BasicDistanceObject<T>::getNormal(Vector<T, 3> point) const
+	{
+		T h = precision;
+		Vector<T, 3> a = { h, -h, -h };
+		Vector<T, 3> b = { -h, -h, h };
+		Vector<T, 3> c = { -h, h, -h };
+		Vector<T, 3> d = { h, h, h };
+		T fa = function->distance(point + a);
+		T fb = function->distance(point + b);
+		T fc = function->distance(point + c);
+		T fd = function->distance(point + d);
+		return (a * fa + b * fb + c * fc + d * fd) / (T(4) * h * h);
+	}
+
+	template<class T>
+	inline const BasicDistanceFunction<T>* BasicDistanceObject<T>::getFunction() const
+	{
+		return function;
+	}
+}
@@ -6,7 +6,7 @@ namespace cg
 	{
 	}
 
-	Vector<unsigned char, 3> Denoiser::pixel(Bitmap<unsigned char> &bitmap, Bitmap<unsigned char> &normals, Bitmap<unsigned char> &distance, unsigned int x, unsigned int y)
+	Vector<unsigned char, 3> Denoiser::pixel(Bitmap<unsigned char> &bitmap, Bitmap<float> &gBuffer, unsigned int x, unsigned int y)
 	{
 		double sumRed = 0;
 		double sumGreen = 0;
@@ -31,13 +31,14 @@ namespace cg
 		{
 			for (int j = top; j <= bottom; j++)
 			{
-				if (std::abs(normals(i, j, 0) - normals(x, y, 0)) < 10)
+				// gleiche grenzen wie frueher mit den 8 bit karten: 10 / 128 fuer die normale und 2 / 8 fuer die distanz
+				if (std::abs(gBuffer(i, j, 0) - gBuffer(x, y, 0)) < 0.078f)
 				{
-					if (std::abs(normals(i, j, 1) - normals(x, y, 1)) < 10)
+					if (std::abs(gBuffer(i, j, 1) - gBuffer(x, y, 1)) < 0.078f)
 					{
-						if (std::abs(normals(i, j, 2) - normals(x, y, 2)) < 10)
+						if (std::abs(gBuffer(i, j, 2) - gBuffer(x, y, 2)) < 0.078f)
 						{
-							if (std::abs(distance(i, j, 0) - distance(x, y, 0)) < 2)
+							if (std::abs(gBuffer(i, j, 3) - gBuffer(x, y, 3)) < 0.25f)
 							{
 								//std::cout << i << " " << j << std::endl << std::endl;
 								double weight = std::exp(-exponent * ((x - i) * (x - i) + (y - j) * (y - j)));
@@ -56,7 +57,7 @@ namespace cg
 		//return { sumRed / sumWeights, 100 * sumWeights, 100 * sumWeights };
 	}
 
-	Bitmap<unsigned char> Denoiser::denoise(Bitmap<unsigned char> &bitmap, Bitmap<unsigned char> &normals, Bitmap<unsigned char> &distance)
+	Bitmap<unsigned char> Denoiser::denoise(Bitmap<unsigned char> &bitmap, Bitmap<float> &gBuffer)
 	{
 		auto [w, h] = bitmap.getSize();
 		Bitmap<unsigned char> denoised(w, h, 3);
@@ -65,7 +66,7 @@ namespace cg
 		{
 			for (int j = 0; j < h; j++)
 			{
-				auto color = pixel(bitmap, normals, distance, i, j);
+				auto color = pixel(bitmap, gBuffer, i, j);
 				denoised(i, j, 0) = color(0);
 				denoised(i, j, 1) = color(1);
 				denoised(i, j, 2) = color(2);
@@ -8,9 +8,10 @@ namespace cg
 	{
 	public:
 		Denoiser(int radius, double exponent);
-		Bitmap<unsigned char> denoise(Bitmap<unsigned char> &bitmap, Bitmap<unsigned char> &normals, Bitmap<unsigned char> &distance);
+		// gBuffer: normale in den ebenen 0 bis 2, distanz in ebene 3
+		Bitmap<unsigned char> denoise(Bitmap<unsigned char> &bitmap, Bitmap<float> &gBuffer);
 	private:
-		Vector<unsigned char, 3> pixel(Bitmap<unsigned char> &bitmap, Bitmap<unsigned char> &normals, Bitmap<unsigned char> &distance, unsigned int x, unsigned int y);
+		Vector<unsigned char, 3> pixel(Bitmap<unsigned char> &bitmap, Bitmap<float> &gBuffer, unsigned int x, unsigned int y);
 
 		int radius;
 		double exponent;
@@ -0,0 +1,198 @@
+#pragma once
+
+#include "PathTracing2.h"
+#include "Matrix.h"
+
+namespace path2
+{
+	// kopie eines objekts an anderer stelle: das objekt (z.b. ein TriangleMesh mit seiner BVH) wird nur einmal gespeichert
+	// und von beliebig vielen instanzen geteilt, jede instanz hat nur eine affine transformation objekt -> welt
+	// der strahl wird in den objektraum transformiert, die richtung bleibt dabei ungenormt, damit die distanz in beiden raeumen gleich ist
+	// farbe, transmission und emission werden vom objekt uebernommen und koennen pro instanz ueberschrieben werden
+	template <class T>
+	class BasicInstance : public BasicRayTraceObject<T>
+	{
+	public:
+		BasicInstance(BasicRayTraceObject<T>* object, Matrix<double, 4, 4> transform);
+
+		bool intersect(Vector<T, 3> origin, Vector<T, 3> direction, T tmin, T tmax, BasicHit<T>& hit);
+		bool occluded(Vector<T, 3> origin, Vector<T, 3> direction, T tmin, T tmax);
+		bool getBounds(AABB<T>& bounds);
+		// nur die obersten drei zeilen werden benutzt, die matrix muss invertierbar sein
+		void setTransform(Matrix<double, 4, 4> transform);
+		Matrix<double, 4, 4> getTransform() const;
+		BasicRayTraceObject<T>* getObject() const;
+	private:
+		Vector<T, 3> toWorld(Vector<T, 3> point) const;
+		void toObject(Vector<T, 3>& origin, Vector<T, 3>& direction) const;
+
+		BasicRayTraceObject<T>* object;
+		Matrix<double, 4, 4> transform;
+		// zeilenweise 3x4: objekt -> welt, welt -> objekt
+		T toWorldMatrix[3][4];
+		T toObjectMatrix[3][4];
+	};
+
+	using Instance = BasicInstance<double>;
+
+	// affine transformationen fuer Instance, p' = M * (p, 1)
+	Matrix<double, 4, 4> translation(double x, double y, double z);
+	Matrix<double, 4, 4> scaling(double s);
+	Matrix<double, 4, 4> rotationY(double angle);
+
+	// impl ---------------------------------
+
+	template<class T>
+	inline BasicInstance<T>::BasicInstance(BasicRayTraceObject<T>* object, Matrix<double, 4, 4> transform) : object(object)
+	{
+		this->color = object->color;
+		this->transmission = object->transmission;
+		this->emission = object->emission;
+		setTransform(transform);
+	}
+
+	template<class T>
+	inline void BasicInstance<T>::setTransform(Matrix<double, 4, 4> transform)
+	{
+		this->transform = transform;
+		double m[3][4];
+		for (unsigned int i = 0; i < 3; i++)
+			for (unsigned int j = 0; j < 4; j++)
+				m[i][j] = transform(i, j);
+
+		// inverse des 3x3 teils ueber die adjunkte, die translation wird danach mit der inversen zurueckgedreht
+		double inverse[3][3] =
+		{
+			{ m[1][1] * m[2][2] - m[1][2] * m[2][1], m[0][2] * m[2][1] - m[0][1] * m[2][2], m[0][1] * m[1][2] - m[0][2] * m[1][1] },
+			{ m[1][2] * m[2][0] - m[1][0] * m[2][2], m[0][0] * m[2][2] - m[0][2] * m[2][0], m[0][2] * m[1][0] - m[0][0] * m[1][2] },
+			{ m[1][0] * m[2][1] - m[1][1] * m[2][0], m[0][1] * m[2][0] - m[0][0] * m[2][1], m[0][0] * m[1][1] - m[0][1] * m[1][0] }
+		};
+		double determinant = m[0][0] * inverse[0][0] + m[0][1] * inverse[1][0] + m[0][2] * inverse[2][0];
+		if (determinant == 0)
+			throw std::runtime_error("Instance transform is not invertible");
+
+		for (unsigned int i = 0; i < 3; i++)
+		{
+			double offset = 0;
+			for (unsigned int j = 0; j < 3; j++)
+			{
+				inverse[i][j] /= determinant;
+				offset -= inverse[i][j] * m[j][3];
+			}
+			for (unsigned int j = 0; j < 3; j++)
+			{
+				toWorldMatrix[i][j] = T(m[i][j]);
+				toObjectMatrix[i][j] = T(inverse[i][j]);
+			}
+			toWorldMatrix[i][3] = T(m[i][3]);
+			toObjectMatrix[i][3] = T(offset);
+		}
+	}
+
+	template<class T>
+	inline Vector<T, 3> BasicInstance<T>::toWorld(Vector<T, 3> point) const
+	{
+		const T (&m)[3][4] = toWorldMatrix;
+		return
+		{
+			m[0][0] * point(0) + m[0][1] * point(1) + m[0][2] * point(2) + m[0][3],
+			m[1][0] * point(0) + m[1][1] * point(1) + m[1][2] * point(2) + m[1][3],
+			m[2][0] * point(0) + m[2][1] * point(1) + m[2][2] * point(2) + m[2][3]
+		};
+	}
+
+	template<class T>
+	inline void BasicInstance<T>::toObject(Vector<T, 3>& origin, Vector<T, 3>& direction) const
+	{
+		const T (&m)[3][4] = toObjectMatrix;
+		origin =
+		{
+			m[0][0] * origin(0) + m[0][1] * origin(1) + m[0][2] * origin(2) + m[0][3],
+			m[1][0] * origin(0) + m[1][1] * origin(1) + m[1][2] * origin(2) + m[1][3],
+			m[2][0] * origin(0) + m[2][1] * origin(1) + m[2][2] * origin(2) + m[2][3]
+		};
+		direction =
+		{
+			m[0][0] * direction(0) + m[0][1] * direction(1) + m[0][2] * direction(2),
+			m[1][0] * direction(0) + m[1][1] * direction(1) + m[1][2] * direction(2),
+			m[2][0] * direction(0) + m[2][1] * direction(1) + m[2][2] * direction(2)
+		};
+	}
+
+	template<class T>
+	inline bool BasicInstance<T>::intersect(Vector<T, 3> origin, Vector<T, 3> direction, T tmin, T tmax, BasicHit<T>& hit)
+	{
+		toObject(origin, direction);
+		BasicHit<T> local;
+		if (!object->intersect(origin, direction, tmin, tmax, local))
+			return false;
+
+		const T (&m)[3][4] = toObjectMatrix;
+		// normalen transformieren mit der transponierten inversen
+		Vector<T, 3> normal =
+		{
+			m[0][0] * local.normal(0) + m[1][0] * local.normal(1) + m[2][0] * local.normal(2),
+			m[0][1] * local.normal(0) + m[1][1] * local.normal(1) + m[2][1] * local.normal(2),
+			m[0][2] * local.normal(0) + m[1][2] * local.normal(1) + m[2][2] * local.normal(2)
+		};
+		hit = { local.distance, this, normal };
+		return true;
+	}
+
+	template<class T>
+	inline bool BasicInstance<T>::occluded(Vector<T, 3> origin, Vector<T, 3> direction, T tmin, T tmax)
+	{
+		toObject(origin, direction);
+		return object->occluded(origin, direction, tmin, tmax);
+	}
+
+	template<class T>
+	inline bool BasicInstance<T>::getBounds(AABB<T>& bounds)
+	{
+		AABB<T> local;
+		if (!object->getBounds(local))
+			return false;
+		bounds = AABB<T>();
+		for (unsigned int i = 0; i < 8; i++)
+			bounds.extend(toWorld({ i & 1 ? local.max(0) : local.min(0), i & 2 ? local.max(1) : local.min(1), i & 4 ? local.max(2) : local.min(2) }));
+		return true;
+	}
+
+	template<class T>
+	inline Matrix<double, 4, 4> BasicInstance<T>::getTransform() const
+	{
+		return transform;
+	}
+
+	template<class T>
+	inline BasicRayTraceObject<T>* BasicInstance<T>::getObject() const
+	{
+		return object;
+	}
+
+	inline Matrix<double, 4, 4> translation(double x, double y, double z)
+	{
+		Matrix<double, 4, 4> matrix = Matrix<double, 4, 4>::Identity();
+		matrix(0, 3) = x;
+		matrix(1, 3) = y;
+		matrix(2, 3) = z;
+		return matrix;
+	}
+
+	inline Matrix<double, 4, 4> scaling(double s)
+	{
+		Matrix<double, 4, 4> matrix = Matrix<double, 4, 4>::Identity() * s;
+		matrix(3, 3) = 1;
+		return matrix;
+	}
+
+	inline Matrix<double, 4, 4> rotationY(double angle)
+	{
+		Matrix<double, 4, 4> matrix = Matrix<double, 4, 4>::Identity();
+		matrix(0, 0) = std::cos(angle);
+		matrix(0, 2) = std::sin(angle);
+		matrix(2, 0) = -std::sin(angle);
+		matrix(2, 2) = std::cos(angle);
+		return matrix;
+	}
+}
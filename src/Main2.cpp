@@ -1,5 +1,13 @@
 #include "Matrix.h"
 #include "Bitmap.h"
+#include "TileScheduler.h"
+#include "BVH.h"
+
+#include <limits>
+#include <memory>
+#include <vector>
+#include <chrono>
+#include <iostream>
 
 using namespace cg;
 
@@ -9,25 +17,43 @@ Vector<T, N> normalize(Vector<T, N> vec)
 	return vec / (::sqrt(vec * vec) + 0.00001);
 }
 
+class RayTraceObject;
+
+// naechster treffer eines strahls, wird von intersect nur ueberschrieben wenn ein naeherer treffer gefunden wurde
+struct Hit
+{
+	double distance;
+	RayTraceObject* object;
+	Vector<double, 3> normal;
+};
+
 class RayTraceObject
 {
 public:
-	virtual std::vector<std::tuple<double, RayTraceObject*, Vector<double, 3>>> getDistance(Vector<double, 3> origin, Vector<double, 3> direction) { return {}; };
+	// sucht den naechsten treffer mit tmin < distanz < tmax, allokiert nichts
+	virtual bool intersect(Vector<double, 3> origin, Vector<double, 3> direction, double tmin, double tmax, Hit& hit) { return false; };
 	// vlt knnte man hier noch zustzlich die grsse des objekts dazugeben, dass kleine objekte keinen extremen schatten machen
 	// plus vlt noch die dichte der umgebung dazuberechnen, dass viele kleine elemente trotzem grsseren schatten machen
 	virtual Vector<double, 3> getDistance(Vector<double, 3> point) { return {}; };
+	// abstand zur oberflaeche, innen negativ, objekte ohne abstandsfunktion sind unendlich weit weg
+	virtual double getSignedDistance(Vector<double, 3> point) { return std::numeric_limits<double>::max(); };
+	// achsenparallele box um das objekt, false fuer unbegrenzte objekte wie die ebene
+	virtual bool getBounds(Vector<double, 3>& min, Vector<double, 3>& max) { return false; };
 	Vector<unsigned char, 3> color;
 };
 
 class TestPlane : public RayTraceObject
 {
 public:
-	std::vector<std::tuple<double, RayTraceObject*, Vector<double, 3>>> getDistance(Vector<double, 3> origin, Vector<double, 3> direction)
+	bool intersect(Vector<double, 3> origin, Vector<double, 3> direction, double tmin, double tmax, Hit& hit)
 	{
-		std::vector<std::tuple<double, RayTraceObject*, Vector<double, 3>>> list;
-		if (direction(1) != 0)
-			list.push_back({ -(origin(1) / direction(1)), this, {0.0, 1.0, 0.0} });
-		return list;
+		if (direction(1) == 0)
+			return false;
+		double distance = -(origin(1) / direction(1));
+		if (distance <= tmin || distance >= tmax)
+			return false;
+		hit = { distance, this, {0.0, 1.0, 0.0} };
+		return true;
 	};
 
 	Vector<double, 3> getDistance(Vector<double, 3> point)
@@ -37,6 +63,11 @@ public:
 		else
 			return { 10, 10, 10 };
 	};
+
+	double getSignedDistance(Vector<double, 3> point)
+	{
+		return point(1);
+	};
 };
 
 class Sphere : public RayTraceObject
@@ -44,23 +75,26 @@ class Sphere : public RayTraceObject
 public:
 	double size;
 	Vector<double, 3> pos;
-	std::vector<std::tuple<double, RayTraceObject*, Vector<double, 3>>> getDistance(Vector<double, 3> origin, Vector<double, 3> direction)
+	bool intersect(Vector<double, 3> origin, Vector<double, 3> direction, double tmin, double tmax, Hit& hit)
 	{
-		std::vector<std::tuple<double, RayTraceObject*, Vector<double, 3>>> list;
-		
-		double discriminant = (2.0 * direction * (origin - pos)) * (direction * (origin - pos) * 2) - (4.0 * direction * direction * (origin * origin + pos * pos - size * size - 2 * (origin * pos)));
-
-		if (discriminant >= 0)
+		Vector<double, 3> offset = origin - pos;
+		double a = direction * direction;
+		double b = direction * offset;
+		double c = offset * offset - size * size;
+		double discriminant = b * b - a * c;
+		if (discriminant < 0)
+			return false;
+
+		double root = std::sqrt(discriminant);
+		double distance = (-b - root) / a;
+		if (distance <= tmin || distance >= tmax)
 		{
-			double distance1 = (-2.0 * direction * (origin - pos) + std::sqrt(discriminant)) / (2.0 * direction * direction);
-			double distance2 = (-2.0 * direction * (origin - pos) - std::sqrt(discriminant)) / (2.0 * direction * direction);
-			Vector<double, 3> normal1 = origin + distance1 * direction - pos;
-			Vector<double, 3> normal2 = origin + distance2 * direction - pos;
-			list.push_back({ distance1, this, normal1 });
-			list.push_back({ distance2, this, normal2 });
+			distance = (-b + root) / a;
+			if (distance <= tmin || distance >= tmax)
+				return false;
 		}
-
-		return list;
+		hit = { distance, this, offset + distance * direction };
+		return true;
 	};
 
 	Vector<double, 3> getDistance(Vector<double, 3> point)
@@ -72,59 +106,114 @@ public:
 		else
 			return { 10, 10, 10 };
 	};
+
+	double getSignedDistance(Vector<double, 3> point)
+	{
+		Vector<double, 3> offset = point - pos;
+		return std::sqrt(offset * offset) - size;
+	};
+
+	bool getBounds(Vector<double, 3>& min, Vector<double, 3>& max)
+	{
+		min = pos - Vector<double, 3>{ size, size, size };
+		max = pos + Vector<double, 3>{ size, size, size };
+		return true;
+	};
 };
 
-std::tuple<double, RayTraceObject*, Vector<double, 3>> getClosestObject(std::vector<std::tuple<double, RayTraceObject*, Vector<double, 3>>> list)
+// begrenzte objekte liegen in einer BVH, die ebene wird linear getestet, nach add() muss build() aufgerufen werden
+class Scene
 {
-	double distance = -1;
-	RayTraceObject* closest = nullptr;
-	Vector<double, 3> normal;
-	for (auto e : list)
+public:
+	void add(RayTraceObject* object)
+	{
+		all.push_back(object);
+		Vector<double, 3> min, max;
+		if (object->getBounds(min, max))
+			bounded.push_back(object);
+		else
+			unbounded.push_back(object);
+	}
+
+	void build()
 	{
-		if ((std::get<0>(e) < distance && std::get<0>(e) > 0) || distance < 0)
+		std::vector<AABB<double>> bounds(bounded.size());
+		for (unsigned int i = 0; i < bounded.size(); i++)
+			bounded[i]->getBounds(bounds[i].min, bounds[i].max);
+		bvh.build(bounds);
+
+		// objekte in blattreihenfolge bringen, damit ein blatt direkt einen bereich von bounded abdeckt
+		std::vector<RayTraceObject*> sorted(bounded.size());
+		for (unsigned int i = 0; i < bounded.size(); i++)
+			sorted[i] = bounded[bvh.getIndices()[i]];
+		bounded = sorted;
+	}
+
+	bool trace(Vector<double, 3> origin, Vector<double, 3> direction, Hit& hit, double tmax) const
+	{
+		bool found = false;
+		for (auto e : unbounded)
 		{
-			distance = std::get<0>(e);
-			closest = std::get<1>(e);
-			normal = std::get<2>(e);
+			if (e->intersect(origin, direction, 0, tmax, hit))
+			{
+				tmax = hit.distance;
+				found = true;
+			}
 		}
-	}
-	if (distance > 0)
-		return { distance, closest, normal };
-	else
-		return { distance, nullptr, normal };
-}
 
+		if (bvh.intersect(origin, direction, tmax, [&](unsigned int first, unsigned int count, double& limit)
+		{
+			bool hitLeaf = false;
+			for (unsigned int i = first; i < first + count; i++)
+			{
+				if (bounded[i]->intersect(origin, direction, 0, limit, hit))
+				{
+					limit = hit.distance;
+					hitLeaf = true;
+				}
+			}
+			return hitLeaf;
+		}))
+			found = true;
+		return found;
+	}
 
-std::tuple<double, RayTraceObject*, Vector<double, 3>> trace(Vector<double, 3> origin, Vector<double, 3> direction, std::vector<RayTraceObject*> scene)
-{
-	std::vector<std::tuple<double, RayTraceObject*, Vector<double, 3>>> list;
-	for (auto e : scene)
+	// alle objekte in der reihenfolge von add(), fuer die abstandsabfragen von AO
+	const std::vector<RayTraceObject*>& getObjects() const
 	{
-		auto elems = e->getDistance(origin, direction);
-		list.insert(list.end(), elems.begin(), elems.end());
+		return all;
 	}
-	return getClosestObject(list);
+private:
+	std::vector<RayTraceObject*> all;
+	std::vector<RayTraceObject*> bounded;
+	std::vector<RayTraceObject*> unbounded;
+	BVH<double> bvh;
+};
+
+bool trace(Vector<double, 3> origin, Vector<double, 3> direction, const Scene& scene, Hit& hit, double tmax = std::numeric_limits<double>::max())
+{
+	return scene.trace(origin, direction, hit, tmax);
 }
 
-std::tuple<double, RayTraceObject*, Vector<double, 3>, Vector<double, 3>> tracePlus(Vector<double, 3> origin, Vector<double, 3> direction, std::vector<RayTraceObject*> scene)
+std::tuple<double, RayTraceObject*, Vector<double, 3>, Vector<double, 3>> tracePlus(Vector<double, 3> origin, Vector<double, 3> direction, const Scene& scene)
 {
-	auto[distance, object, normal] = trace(origin, direction, scene);
-	normal = normalize(normal);
-	Vector<double, 3> pos = origin + distance * direction;
+	Hit hit;
+	if (!trace(origin, direction, scene, hit))
+		return { -1, nullptr, {}, origin };
+	Vector<double, 3> normal = normalize(hit.normal);
+	Vector<double, 3> pos = origin + hit.distance * direction;
 	pos = pos + normal * 0.00001; // delta wert um nicht das gleiche objekt am gleichen ort wieder zu treffen
-	return { distance, object, normal, pos };
+	return { hit.distance, hit.object, normal, pos };
 }
 
-double getAOLine(double max, Vector<double, 3> normal, Vector<double, 3> pos, std::vector<RayTraceObject*> scene)
+// abstand zum naechsten objekt entlang der normalen, hoechstens max
+// strahl endet bei max, weiter entfernte objekte werden gar nicht erst als treffer gezaehlt, normale und versatz braucht es nicht
+double getAOLine(double max, Vector<double, 3> normal, Vector<double, 3> pos, const Scene& scene)
 {
-	auto[distance, object0, normal0, pos0] = tracePlus(pos, normal, scene);
-	if (object0 == nullptr)
+	Hit hit;
+	if (!trace(pos, normal, scene, hit, max))
 		return max;
-	if (distance < 0)
-		return 0;
-
-	double realDistance = (std::min)(max, distance);
-	return realDistance;
+	return hit.distance;
 }
 
 //double getAONormal(RayTraceObject* object, Vector<double, 3> normal, Vector<double, 3> point)
@@ -133,7 +222,7 @@ double getAOLine(double max, Vector<double, 3> normal, Vector<double, 3> pos, st
 //	return -normal * vec;
 //}
 
-std::tuple<double, Vector<double, 3>> getMaxAO(std::vector<RayTraceObject*> scene, Vector<double, 3> normal, Vector<double, 3> point)
+std::tuple<double, Vector<double, 3>> getMaxAO(const std::vector<RayTraceObject*>& scene, Vector<double, 3> normal, Vector<double, 3> point)
 {
 	double closest = 1000;
 	double shadowValue = 0;
@@ -165,42 +254,151 @@ std::tuple<double, Vector<double, 3>> getMaxAO(std::vector<RayTraceObject*> scen
 	return { closest, returnNormal };
 }
 
-Bitmap<unsigned char> raytrace()
+// signierter abstand der ganzen szene auf einem regelmaessigen gitter, einmal pro szene gebacken und danach trilinear abgetastet
+// AO kostet damit pro pixel eine feste anzahl gitterzugriffe statt eines aufrufs pro objekt
+// ausserhalb des gitters gilt der raum als leer, die ebene ist dort ohnehin unverdeckt
+class AOVolume
 {
-	Bitmap<unsigned char> bitmap(1000, 1000, 3);
-	bitmap.fill({ 255, 255, 255 });
-
-	TestPlane plane;
-	plane.color = { 255, 255, 255 };
+public:
+	// das gitter umfasst die boxen aller begrenzten objekte, um range vergroessert: weiter weg verdeckt nichts mehr,
+	// unbegrenzte objekte wie die ebene gehen nur innerhalb dieser box ein, ausserhalb gibt getDistance max zurueck
+	// spacing ist die kantenlaenge einer zelle, die zeilen werden als kacheln ueber (y, z) auf alle kerne verteilt
+	AOVolume(const std::vector<RayTraceObject*>& scene, double spacing) : spacing(spacing)
+	{
+		Vector<double, 3> max;
+		bool bounded = false;
+		for (auto o : scene)
+		{
+			Vector<double, 3> objectMin, objectMax;
+			if (!o->getBounds(objectMin, objectMax))
+				continue;
+			for (unsigned int i = 0; i < 3; i++)
+			{
+				min(i) = bounded ? (std::min)(min(i), objectMin(i) - range) : objectMin(i) - range;
+				max(i) = bounded ? (std::max)(max(i), objectMax(i) + range) : objectMax(i) + range;
+			}
+			bounded = true;
+		}
+		for (unsigned int i = 0; i < 3; i++)
+			size[i] = bounded ? static_cast<unsigned int>(std::ceil((max(i) - min(i)) / spacing)) + 1 : 0;
+		distances.resize(static_cast<size_t>(size[0]) * size[1] * size[2]);
 
-	Sphere sphere;
-	sphere.color = { 200, 200, 255 };
-	sphere.size = 1;
-	sphere.pos = { 0.15, 1, 6.5 };
+		TileScheduler scheduler(size[1], size[2], 8);
+		scheduler.run([&](Tile tile)
+		{
+			for (unsigned int z = tile.y; z < tile.y + tile.height; z++)
+			{
+				for (unsigned int y = tile.x; y < tile.x + tile.width; y++)
+				{
+					for (unsigned int x = 0; x < size[0]; x++)
+					{
+						Vector<double, 3> point = { this->min(0) + x * spacing, this->min(1) + y * spacing, this->min(2) + z * spacing };
+						double distance = std::numeric_limits<double>::max();
+						for (auto o : scene)
+							distance = (std::min)(distance, o->getSignedDistance(point));
+						distances[(static_cast<size_t>(z) * size[1] + y) * size[0] + x] = static_cast<float>((std::min)(distance, 1e30));
+					}
+				}
+			}
+		});
+	}
 
-	Sphere sphere2;
-	sphere2.color = { 255, 200, 200 };
-	sphere2.size = 0.75;
-	sphere2.pos = { -1, 0.75, 5.1 };
+	double getDistance(Vector<double, 3> point)
+	{
+		double coordinates[3];
+		unsigned int cell[3];
+		for (unsigned int i = 0; i < 3; i++)
+		{
+			coordinates[i] = (point(i) - min(i)) / spacing;
+			if (!(coordinates[i] >= 0 && coordinates[i] + 1 < size[i]))
+				return std::numeric_limits<double>::max();
+			cell[i] = static_cast<unsigned int>(coordinates[i]);
+			coordinates[i] -= cell[i];
+		}
+		const float* corner = &distances[(static_cast<size_t>(cell[2]) * size[1] + cell[1]) * size[0] + cell[0]];
+		size_t dy = size[0];
+		size_t dz = static_cast<size_t>(size[0]) * size[1];
+		auto lerp = [](double a, double b, double t) { return a + (b - a) * t; };
+		double y0 = lerp(lerp(corner[0], corner[1], coordinates[0]), lerp(corner[dy], corner[dy + 1], coordinates[0]), coordinates[1]);
+		double y1 = lerp(lerp(corner[dz], corner[dz + 1], coordinates[0]), lerp(corner[dz + dy], corner[dz + dy + 1], coordinates[0]), coordinates[1]);
+		return lerp(y0, y1, coordinates[2]);
+	}
 
-	Sphere sphere3;
-	sphere3.color = { 200, 255, 200 };
-	sphere3.size = 0.5;
-	sphere3.pos = { 0.5, 0.5, 5 };
+	// an der stelle h entlang der normalen sollte die naechste oberflaeche h weit weg sein, jeder fehlbetrag verdeckt
+	// nahe stellen zaehlen doppelt so viel wie die naechste, ergebnis 0 unverdeckt bis 1 ganz verdeckt
+	double getOcclusion(Vector<double, 3> point, Vector<double, 3> normal)
+	{
+		double occlusion = 0;
+		double weight = 1;
+		double weightSum = 0;
+		for (unsigned int i = 1; i <= steps; i++)
+		{
+			double h = range * i / steps;
+			double missing = (h - getDistance(point + normal * h)) / h;
+			occlusion += weight * (std::min)((std::max)(missing, 0.0), 1.0);
+			weightSum += weight;
+			weight *= 0.5;
+		}
+		return occlusion / weightSum;
+	}
 
-	std::vector<RayTraceObject*> scene;
-	scene.push_back(&plane);
-	scene.push_back(&sphere);
-	scene.push_back(&sphere2);
-	scene.push_back(&sphere3);
+	// ein kegel um die normale und vier geneigte werden mit sphere tracing verfolgt, jeder ist nur so offen
+	// wie das kleinste verhaeltnis abstand / (weg * tan(oeffnungswinkel)) unterwegs, gewichtet mit dem kosinus zur normalen
+	double getConeOcclusion(Vector<double, 3> point, Vector<double, 3> normal)
+	{
+		const double tanHalfAngle = 0.6;
+		Vector<double, 3> helper = std::abs(normal(0)) < 0.9 ? Vector<double, 3>{ 1.0, 0.0, 0.0 } : Vector<double, 3>{ 0.0, 1.0, 0.0 };
+		Vector<double, 3> tangent = normalize(helper - normal * (helper * normal));
+		Vector<double, 3> bitangent = { normal(1) * tangent(2) - normal(2) * tangent(1), normal(2) * tangent(0) - normal(0) * tangent(2), normal(0) * tangent(1) - normal(1) * tangent(0) };
+		Vector<double, 3> directions[5] = { normal, normal + tangent, normal - tangent, normal + bitangent, normal - bitangent };
+
+		double visibility = 0;
+		double weightSum = 0;
+		for (unsigned int c = 0; c < 5; c++)
+		{
+			Vector<double, 3> direction = normalize(directions[c]);
+			double weight = direction * normal;
+			double cone = 1;
+			for (double t = spacing; t < range && cone > 0;)
+			{
+				double distance = getDistance(point + direction * t);
+				cone = (std::min)(cone, distance / (t * tanHalfAngle));
+				t += (std::max)(distance, spacing * 0.5);
+			}
+			visibility += weight * (std::max)(cone, 0.0);
+			weightSum += weight;
+		}
+		return 1 - visibility / weightSum;
+	}
+private:
+	// reichweite wie bei getMaxAO, weiter entfernte objekte verdecken nicht
+	static constexpr double range = 1.0;
+	static constexpr unsigned int steps = 5;
+
+	Vector<double, 3> min;
+	double spacing;
+	unsigned int size[3];
+	std::vector<float> distances;
+};
 
-	Vector<double, 3> origin = { 0, 3, -1 };
+enum class AOMode
+{
+	// getMaxAO ueber alle objekte, kosten wachsen mit der szene
+	Objects,
+	// gebackenes AOVolume entlang der normalen
+	Volume,
+	// gebackenes AOVolume mit kegeln
+	Cone
+};
 
-	for (int i = 0; i < 1000; i++)
+void run(Tile tile, Vector<double, 3> origin, Bitmap<unsigned char>* bitmap, const Scene& scene, AOMode mode, AOVolume* volume)
+{
+	auto [width, height] = bitmap->getSize();
+	for (unsigned int i = tile.x; i < tile.x + tile.width; i++)
 	{
-		for (int j = 0; j < 1000; j++)
+		for (unsigned int j = tile.y; j < tile.y + tile.height; j++)
 		{
-			Vector<double, 3> dest = { -i / 1000.0 + 0.5, 2.7 - j / 1000.0 + 0.5, 0 };
+			Vector<double, 3> dest = { -(i - width / 2.0) / height, 2.7 - (j - height / 2.0) / height, 0 };
 			Vector<double, 3> direction = dest - origin;
 
 			auto[distance, object, normal, pos] = tracePlus(origin, direction, scene);
@@ -213,14 +411,21 @@ Bitmap<unsigned char> raytrace()
 				//double shadow = (1 - std::pow(1 - dist, 8)) * 1 + 0.0;
 				//--------------------------------------------
 
-				auto[aoDistance, aoNormal] = getMaxAO(scene, normal, pos);
-
 				double shadow = 1;
 
-				if (aoDistance <= 1)
+				if (mode == AOMode::Objects)
+				{
+					auto[aoDistance, aoNormal] = getMaxAO(scene.getObjects(), normal, pos);
+					if (aoDistance <= 1)
+					{
+						double shadowProduct = -normal * aoNormal;
+						shadow = (1 - std::pow((1 - aoDistance), 8) * (shadowProduct)) * 0.9 + 0.1;
+					}
+				}
+				else
 				{
-					double shadowProduct = -normal * aoNormal;
-					shadow = (1 - std::pow((1 - aoDistance), 8) * (shadowProduct)) * 0.9 + 0.1;
+					double occlusion = mode == AOMode::Volume ? volume->getOcclusion(pos, normal) : volume->getConeOcclusion(pos, normal);
+					shadow = (1 - occlusion) * 0.9 + 0.1;
 				}
 
 				Vector<double, 3> lightVec = { 0.0, -1.0, 0.0 };
@@ -229,9 +434,9 @@ Bitmap<unsigned char> raytrace()
 				directLight *= 0.5;
 				directLight += 0.5;
 				Vector<unsigned char, 3> color = object->color;
-				bitmap(i, j, 0) = shadow * directLight * color(0);
-				bitmap(i, j, 1) = shadow * directLight * color(1);
-				bitmap(i, j, 2) = shadow * directLight * color(2);
+				(*bitmap)(i, j, 0) = shadow * directLight * color(0);
+				(*bitmap)(i, j, 1) = shadow * directLight * color(1);
+				(*bitmap)(i, j, 2) = shadow * directLight * color(2);
 				//bitmap(i, j, 0) = sphere3.getDistance(pos) * sphere3.getDistance(pos) * 10;
 				//bitmap(i, j, 1) = sphere3.getDistance(pos) * sphere3.getDistance(pos) * 10;
 				//bitmap(i, j, 2) = sphere3.getDistance(pos) * sphere3.getDistance(pos) * 10;
@@ -250,6 +455,55 @@ Bitmap<unsigned char> raytrace()
 			}
 		}
 	}
+}
+
+// threadCount 0 nimmt alle kerne
+Bitmap<unsigned char> raytrace(unsigned int width = 1000, unsigned int height = 1000, AOMode mode = AOMode::Objects, unsigned int threadCount = 0)
+{
+	Bitmap<unsigned char> bitmap(width, height, 3);
+	bitmap.fill({ 255, 255, 255 });
+
+	TestPlane plane;
+	plane.color = { 255, 255, 255 };
+
+	Sphere sphere;
+	sphere.color = { 200, 200, 255 };
+	sphere.size = 1;
+	sphere.pos = { 0.15, 1, 6.5 };
+
+	Sphere sphere2;
+	sphere2.color = { 255, 200, 200 };
+	sphere2.size = 0.75;
+	sphere2.pos = { -1, 0.75, 5.1 };
+
+	Sphere sphere3;
+	sphere3.color = { 200, 255, 200 };
+	sphere3.size = 0.5;
+	sphere3.pos = { 0.5, 0.5, 5 };
+
+	Scene scene;
+	scene.add(&plane);
+	scene.add(&sphere);
+	scene.add(&sphere2);
+	scene.add(&sphere3);
+	scene.build();
+
+	Vector<double, 3> origin = { 0, 3, -1 };
+
+	auto start = std::chrono::steady_clock::now();
+	std::unique_ptr<AOVolume> volume;
+	if (mode != AOMode::Objects)
+	{
+		volume = std::make_unique<AOVolume>(scene.getObjects(), 0.04);
+		std::cout << "AO volume baked in " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms" << std::endl;
+		start = std::chrono::steady_clock::now();
+	}
+
+	TileScheduler scheduler(width, height, 16, threadCount);
+	scheduler.run([&](Tile tile) { run(tile, origin, &bitmap, scene, mode, volume.get()); });
+	scheduler.printStatistics(std::cout);
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << width << "x" << height << " in " << seconds * 1000.0 << " ms, " << width * height / seconds / 1e6 << " Mpixel/s" << std::endl;
 
 	return bitmap;
 }
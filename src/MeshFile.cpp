@@ -0,0 +1,422 @@
+#include "MeshFile.h"
+#include "Utils.h"
+
+#include <cstdio>
+#include <cstring>
+#include <charconv>
+#include <string_view>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <algorithm>
+#include <cctype>
+
+#ifdef _WIN32
+	#define NOMINMAX
+	#include <windows.h>
+#else
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+namespace cg
+{
+	static const char meshMagic[8] = { 'C', 'G', 'M', 'E', 'S', 'H', '1', 0 };
+
+	static std::string_view nextToken(const char*& begin, const char* end)
+	{
+		while (begin < end && (*begin == ' ' || *begin == '\t' || *begin == '\r'))
+			begin++;
+		const char* start = begin;
+		while (begin < end && *begin != ' ' && *begin != '\t' && *begin != '\r')
+			begin++;
+		return std::string_view(start, begin - start);
+	}
+
+	template <class T>
+	static bool parseNumber(std::string_view token, T& value)
+	{
+		auto [ptr, code] = std::from_chars(token.data(), token.data() + token.size(), value);
+		return code == std::errc() && ptr != token.data();
+	}
+
+	static void fan(MeshData& mesh, const std::vector<uint32_t>& polygon)
+	{
+		for (size_t i = 2; i < polygon.size(); i++)
+		{
+			mesh.indices.push_back(polygon[0]);
+			mesh.indices.push_back(polygon[i - 1]);
+			mesh.indices.push_back(polygon[i]);
+		}
+	}
+
+	MeshData importOBJ(const std::string& filename)
+	{
+		MeshData mesh;
+		std::vector<uint32_t> polygon;
+		unsigned int line = 0;
+		auto error = [&](const std::string& message)
+		{
+			throw std::runtime_error(filename + " line " + std::to_string(line) + ": " + message);
+		};
+
+		readLines(filename, [&](const char* begin, const char* end)
+		{
+			line++;
+			std::string_view keyword = nextToken(begin, end);
+			if (keyword == "v")
+			{
+				for (int i = 0; i < 3; i++)
+				{
+					float value;
+					if (!parseNumber(nextToken(begin, end), value))
+						error("invalid vertex");
+					mesh.vertices.push_back(value);
+				}
+			}
+			else if (keyword == "f")
+			{
+				// v, v/vt, v//vn oder v/vt/vn, negative indizes zaehlen vom ende
+				polygon.clear();
+				for (std::string_view token = nextToken(begin, end); !token.empty(); token = nextToken(begin, end))
+				{
+					long long index;
+					if (!parseNumber(token, index) || index == 0)
+						error("invalid face index");
+					long long vertexCount = mesh.vertices.size() / 3;
+					index = index < 0 ? vertexCount + index : index - 1;
+					if (index < 0 || index >= vertexCount)
+						error("face index out of range");
+					polygon.push_back((uint32_t)index);
+				}
+				fan(mesh, polygon);
+			}
+			// normalen, texturkoordinaten, gruppen und materialien werden ignoriert
+		});
+		return mesh;
+	}
+
+	namespace
+	{
+		enum class PLYType { Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64 };
+
+		PLYType plyType(std::string_view type)
+		{
+			if (type == "char" || type == "int8") return PLYType::Int8;
+			if (type == "uchar" || type == "uint8") return PLYType::UInt8;
+			if (type == "short" || type == "int16") return PLYType::Int16;
+			if (type == "ushort" || type == "uint16") return PLYType::UInt16;
+			if (type == "int" || type == "int32") return PLYType::Int32;
+			if (type == "uint" || type == "uint32") return PLYType::UInt32;
+			if (type == "float" || type == "float32") return PLYType::Float32;
+			if (type == "double" || type == "float64") return PLYType::Float64;
+			throw std::runtime_error("Unknown PLY type " + std::string(type));
+		}
+
+		struct PLYProperty
+		{
+			std::string name;
+			PLYType type;
+			// bei listen der typ der anzahl, type ist dann der typ der eintraege
+			PLYType countType;
+			bool list;
+		};
+
+		struct PLYElement
+		{
+			std::string name;
+			unsigned int count;
+			std::vector<PLYProperty> properties;
+		};
+
+		template <class V>
+		double plyRead(const unsigned char*& data, const unsigned char* end)
+		{
+			if (end - data < (long long)sizeof(V))
+				throw std::runtime_error("PLY file is truncated");
+			V value;
+			std::memcpy(&value, data, sizeof(V));
+			data += sizeof(V);
+			return (double)value;
+		}
+
+		double plyRead(const unsigned char*& data, const unsigned char* end, PLYType type)
+		{
+			switch (type)
+			{
+			case PLYType::Int8: return plyRead<int8_t>(data, end);
+			case PLYType::UInt8: return plyRead<uint8_t>(data, end);
+			case PLYType::Int16: return plyRead<int16_t>(data, end);
+			case PLYType::UInt16: return plyRead<uint16_t>(data, end);
+			case PLYType::Int32: return plyRead<int32_t>(data, end);
+			case PLYType::UInt32: return plyRead<uint32_t>(data, end);
+			case PLYType::Float32: return plyRead<float>(data, end);
+			case PLYType::Float64: return plyRead<double>(data, end);
+			}
+			return 0;
+		}
+	}
+
+	MeshData importPLY(const std::string& filename)
+	{
+		std::ifstream stream(filename, std::ios::binary);
+		if (!stream)
+			throw std::runtime_error("Could not open " + filename);
+		std::vector<unsigned char> file((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+
+		// kopf ist immer ascii und endet mit end_header
+		const char* begin = reinterpret_cast<const char*>(file.data());
+		const char* end = begin + file.size();
+		std::vector<PLYElement> elements;
+		std::string format;
+		bool header = true;
+		while (header)
+		{
+			const char* newline = static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+			if (newline == nullptr)
+				throw std::runtime_error(filename + ": PLY header without end_header");
+			const char* lineEnd = newline;
+			std::string_view keyword = nextToken(begin, lineEnd);
+			if (keyword == "format")
+				format = std::string(nextToken(begin, lineEnd));
+			else if (keyword == "element")
+			{
+				PLYElement element;
+				element.name = std::string(nextToken(begin, lineEnd));
+				if (!parseNumber(nextToken(begin, lineEnd), element.count))
+					throw std::runtime_error(filename + ": invalid PLY element count");
+				elements.push_back(element);
+			}
+			else if (keyword == "property")
+			{
+				if (elements.empty())
+					throw std::runtime_error(filename + ": PLY property before element");
+				PLYProperty property;
+				std::string_view type = nextToken(begin, lineEnd);
+				property.list = type == "list";
+				if (property.list)
+				{
+					property.countType = plyType(nextToken(begin, lineEnd));
+					type = nextToken(begin, lineEnd);
+				}
+				property.type = plyType(type);
+				property.name = std::string(nextToken(begin, lineEnd));
+				elements.back().properties.push_back(property);
+			}
+			else if (keyword == "end_header")
+				header = false;
+			begin = newline + 1;
+		}
+
+		bool ascii = format == "ascii";
+		if (!ascii && format != "binary_little_endian")
+			throw std::runtime_error(filename + ": unsupported PLY format " + format);
+
+		MeshData mesh;
+		std::vector<uint32_t> polygon;
+		const unsigned char* data = reinterpret_cast<const unsigned char*>(begin);
+		const unsigned char* dataEnd = file.data() + file.size();
+
+		// ascii: ein element pro zeile, die werte werden der reihe nach gelesen
+		auto asciiValue = [&]() -> double
+		{
+			const char* text = reinterpret_cast<const char*>(data);
+			const char* textEnd = reinterpret_cast<const char*>(dataEnd);
+			while (text < textEnd && std::isspace((unsigned char)*text))
+				text++;
+			const char* start = text;
+			while (text < textEnd && !std::isspace((unsigned char)*text))
+				text++;
+			std::string_view token(start, text - start);
+			data = reinterpret_cast<const unsigned char*>(text);
+			if (token.empty())
+				throw std::runtime_error(filename + ": PLY file is truncated");
+			double value;
+			if (!parseNumber(token, value))
+				throw std::runtime_error(filename + ": invalid PLY value " + std::string(token));
+			return value;
+		};
+		auto value = [&](PLYType type) -> double
+		{
+			return ascii ? asciiValue() : plyRead(data, dataEnd, type);
+		};
+
+		for (auto& element : elements)
+		{
+			bool vertex = element.name == "vertex";
+			bool face = element.name == "face";
+			for (unsigned int i = 0; i < element.count; i++)
+			{
+				float position[3] = { 0, 0, 0 };
+				for (auto& property : element.properties)
+				{
+					if (property.list)
+					{
+						unsigned int count = (unsigned int)value(property.countType);
+						polygon.clear();
+						for (unsigned int j = 0; j < count; j++)
+							polygon.push_back((uint32_t)value(property.type));
+						if (face && (property.name == "vertex_indices" || property.name == "vertex_index"))
+						{
+							for (auto index : polygon)
+							{
+								if (index >= mesh.vertices.size() / 3)
+									throw std::runtime_error(filename + ": PLY face index out of range");
+							}
+							fan(mesh, polygon);
+						}
+					}
+					else
+					{
+						double v = value(property.type);
+						if (vertex && property.name.size() == 1 && property.name[0] >= 'x' && property.name[0] <= 'z')
+							position[property.name[0] - 'x'] = (float)v;
+					}
+				}
+				if (vertex)
+					mesh.vertices.insert(mesh.vertices.end(), position, position + 3);
+			}
+		}
+		return mesh;
+	}
+
+	MeshData importMesh(const std::string& filename)
+	{
+		std::string extension = filename.substr(filename.find_last_of('.') + 1);
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+		if (extension == "obj")
+			return importOBJ(filename);
+		if (extension == "ply")
+			return importPLY(filename);
+		throw std::runtime_error("Unknown mesh format " + filename);
+	}
+
+	void saveMesh(const std::string& filename, const MeshData& mesh)
+	{
+		std::unique_ptr<std::FILE, int(*)(std::FILE*)> file(std::fopen(filename.c_str(), "wb"), std::fclose);
+		if (!file)
+			throw std::runtime_error("Could not open " + filename);
+
+		MeshHeader header;
+		std::memcpy(header.magic, meshMagic, sizeof(meshMagic));
+		header.vertexCount = (uint32_t)(mesh.vertices.size() / 3);
+		header.triangleCount = (uint32_t)(mesh.indices.size() / 3);
+		bool written = std::fwrite(&header, sizeof(header), 1, file.get()) == 1;
+		written = written && std::fwrite(mesh.vertices.data(), sizeof(float), header.vertexCount * 3, file.get()) == header.vertexCount * 3;
+		written = written && std::fwrite(mesh.indices.data(), sizeof(uint32_t), header.triangleCount * 3, file.get()) == header.triangleCount * 3;
+		if (!written)
+			throw std::runtime_error("Could not write " + filename);
+	}
+
+	void convertMesh(const std::string& input, const std::string& output)
+	{
+		saveMesh(output, importMesh(input));
+	}
+
+	MappedMesh::MappedMesh(const std::string& filename) : data(nullptr), size(0)
+	{
+#ifdef _WIN32
+		file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			throw std::runtime_error("Could not open " + filename);
+		LARGE_INTEGER fileSize;
+		GetFileSizeEx(file, &fileSize);
+		size = (size_t)fileSize.QuadPart;
+		mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping != nullptr)
+			data = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+		if (data == nullptr)
+		{
+			if (mapping != nullptr)
+				CloseHandle(mapping);
+			CloseHandle(file);
+			throw std::runtime_error("Could not map " + filename);
+		}
+#else
+		int file = open(filename.c_str(), O_RDONLY);
+		if (file < 0)
+			throw std::runtime_error("Could not open " + filename);
+		struct stat status;
+		fstat(file, &status);
+		size = (size_t)status.st_size;
+		void* mapped = size > 0 ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0) : MAP_FAILED;
+		close(file);
+		if (mapped == MAP_FAILED)
+			throw std::runtime_error("Could not map " + filename);
+		data = static_cast<const unsigned char*>(mapped);
+#endif
+
+		// kopf und groesse pruefen, die vertices werden nicht angefasst
+		const MeshHeader* header = reinterpret_cast<const MeshHeader*>(data);
+		bool valid = size >= sizeof(MeshHeader) && std::memcmp(header->magic, meshMagic, sizeof(meshMagic)) == 0
+			&& size >= sizeof(MeshHeader) + (size_t)header->vertexCount * 3 * sizeof(float) + (size_t)header->triangleCount * 3 * sizeof(uint32_t);
+		if (!valid)
+		{
+			unmap();
+			throw std::runtime_error(filename + " is not a mesh file");
+		}
+
+		// die indizes einmal durchgehen wie beim OBJ import, sonst liest getVertex bei einer kaputten datei hinter die abbildung
+		const uint32_t* indices = getIndices();
+		uint32_t vertexCount = header->vertexCount;
+		for (size_t i = 0; i < (size_t)header->triangleCount * 3; i++)
+		{
+			if (indices[i] >= vertexCount)
+			{
+				unmap();
+				throw std::runtime_error(filename + ": face index out of range");
+			}
+		}
+	}
+
+	MappedMesh::MappedMesh(MappedMesh&& mesh) noexcept : data(mesh.data), size(mesh.size)
+	{
+#ifdef _WIN32
+		file = mesh.file;
+		mapping = mesh.mapping;
+#endif
+		mesh.data = nullptr;
+		mesh.size = 0;
+	}
+
+	MappedMesh::~MappedMesh()
+	{
+		unmap();
+	}
+
+	void MappedMesh::unmap()
+	{
+		if (data == nullptr)
+			return;
+#ifdef _WIN32
+		UnmapViewOfFile(data);
+		CloseHandle(mapping);
+		CloseHandle(file);
+#else
+		munmap(const_cast<unsigned char*>(data), size);
+#endif
+		data = nullptr;
+	}
+
+	const float* MappedMesh::getVertices() const
+	{
+		return reinterpret_cast<const float*>(data + sizeof(MeshHeader));
+	}
+
+	const uint32_t* MappedMesh::getIndices() const
+	{
+		return reinterpret_cast<const uint32_t*>(data + sizeof(MeshHeader) + (size_t)getVertexCount() * 3 * sizeof(float));
+	}
+
+	unsigned int MappedMesh::getVertexCount() const
+	{
+		return reinterpret_cast<const MeshHeader*>(data)->vertexCount;
+	}
+
+	unsigned int MappedMesh::getTriangleCount() const
+	{
+		return reinterpret_cast<const MeshHeader*>(data)->triangleCount;
+	}
+}
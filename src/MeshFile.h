@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+namespace cg
+{
+	// dreiecksnetz als flache arrays: x, y, z pro vertex und drei vertexindizes pro dreieck
+	struct MeshData
+	{
+		std::vector<float> vertices;
+		std::vector<uint32_t> indices;
+	};
+
+	// text- und binaerformate einlesen, polygone werden als faecher in dreiecke zerlegt
+	// wirft std::runtime_error bei nicht lesbaren oder fehlerhaften dateien
+	MeshData importOBJ(const std::string& filename);
+	// ascii und binary_little_endian, es werden nur x, y, z der vertices und die vertex_indices der faces gelesen
+	MeshData importPLY(const std::string& filename);
+	// waehlt OBJ oder PLY anhand der dateiendung
+	MeshData importMesh(const std::string& filename);
+
+	// binaerformat: MeshHeader, dann vertexCount * 3 float und triangleCount * 3 uint32_t, alles little endian
+	// die arrays liegen so in der datei wie im speicher und koennen nach mmap direkt benutzt werden
+	struct MeshHeader
+	{
+		char magic[8];
+		uint32_t vertexCount;
+		uint32_t triangleCount;
+	};
+
+	void saveMesh(const std::string& filename, const MeshData& mesh);
+	// einmaliger import von OBJ/PLY in das binaerformat
+	void convertMesh(const std::string& input, const std::string& output);
+
+	// blendet eine binaere mesh datei nur lesend in den speicher ein, es wird nichts geparst oder kopiert
+	// nur die indizes werden beim oeffnen einmal auf gueltigkeit geprueft
+	class MappedMesh
+	{
+	public:
+		MappedMesh(const std::string& filename);
+		MappedMesh(MappedMesh&& mesh) noexcept;
+		MappedMesh(const MappedMesh&) = delete;
+		MappedMesh& operator = (const MappedMesh&) = delete;
+		~MappedMesh();
+
+		const float* getVertices() const;
+		const uint32_t* getIndices() const;
+		unsigned int getVertexCount() const;
+		unsigned int getTriangleCount() const;
+	private:
+		void unmap();
+
+		const unsigned char* data;
+		size_t size;
+#ifdef _WIN32
+		void* file;
+		void* mapping;
+#endif
+	};
+}
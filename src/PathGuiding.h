@@ -0,0 +1,382 @@
+#pragma once
+
+#include "Matrix.h"
+#include "BVH.h"
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+namespace path2
+{
+	using namespace cg;
+
+	// ein abprall eines trainingspfads: radiance ist das licht, das aus direction bei position ankommt, pdf die dichte der richtung
+	// throughput ist nur zwischenspeicher fuer tracePixel, das radiance erst am ende des pfads kennt
+	template <class T>
+	struct GuidingRecord
+	{
+		Vector<T, 3> position;
+		Vector<T, 3> direction;
+		T pdf;
+		Vector<T, 3> throughput;
+		Vector<T, 3> radiance;
+	};
+
+	// quadtree ueber alle richtungen (Mueller et al. 2017), die kugel wird flaechentreu auf [0, 1]^2 abgebildet (cos theta, phi)
+	// jeder knoten speichert die summe des eingetragenen lichts seiner vier viertel, zellen mit viel licht werden beim verfeinern weiter geteilt
+	template <class T>
+	class BasicDirectionTree
+	{
+	public:
+		BasicDirectionTree();
+
+		void record(Vector<T, 3> direction, T value);
+		// richtung proportional zu den summen, pdf im raumwinkel, nur sinnvoll wenn getTotal() > 0 und nach prepare()
+		Vector<T, 3> sample(T u1, T u2, T& pdf) const;
+		T pdf(Vector<T, 3> direction) const;
+		T getTotal() const;
+		unsigned int getNodeCount() const;
+		// neue leere struktur: jede zelle mit mehr als fraction des gesamten lichts wird geteilt, hoechstens bis maxDepth
+		BasicDirectionTree<T> refine(T fraction, unsigned int maxDepth) const;
+		// rechnet die summen einmal in dichten pro viertel um, danach wird nur noch abgetastet und nicht mehr eingetragen
+		void prepare();
+	private:
+		// child == 0 heisst blatt, die wurzel ist nie ein kind
+		// density ist 4 * sum / summe des knotens, das produkt entlang des wegs ist die dichte auf [0, 1]^2
+		struct Node
+		{
+			T sum[4];
+			T density[4];
+			unsigned int child[4];
+		};
+
+		static void toSquare(Vector<T, 3> direction, T& u, T& v);
+		static Vector<T, 3> fromSquare(T u, T v);
+		void refineNode(int node, const T (&sums)[4], unsigned int target, unsigned int depth, T limit, unsigned int maxDepth, BasicDirectionTree<T>& result) const;
+
+		std::vector<Node> nodes;
+	};
+
+	// SD-tree: binaerer baum ueber den raum, jedes blatt hat einen quadtree zum abtasten (aus der letzten iteration) und einen zum eintragen
+	// nach jeder iteration werden blaetter mit mehr als splitCount * sqrt(2^iteration) eintraegen geteilt und die quadtrees neu aufgebaut
+	// record und update sind nicht threadsicher, der renderer sammelt die eintraege eines durchgangs und traegt sie danach in fester reihenfolge ein
+	template <class T>
+	class BasicPathGuide
+	{
+	public:
+		BasicPathGuide(AABB<T> bounds, unsigned int splitCount = 12000);
+
+		void record(const GuidingRecord<T>& record);
+		void update();
+		// verteilung fuer position, nullptr solange dort noch nichts gelernt wurde
+		const BasicDirectionTree<T>* getDistribution(Vector<T, 3> position) const;
+		unsigned int getIteration() const;
+		unsigned int getRegionCount() const;
+		unsigned int getDirectionNodeCount() const;
+	private:
+		struct Region
+		{
+			BasicDirectionTree<T> sampling;
+			BasicDirectionTree<T> recording;
+			unsigned int count;
+		};
+
+		// blatt wenn child[0] == 0, die kinder teilen die box entlang axis in der mitte
+		struct Node
+		{
+			unsigned int axis;
+			unsigned int child[2];
+			unsigned int region;
+		};
+
+		unsigned int findRegion(Vector<T, 3> position) const;
+
+		AABB<T> bounds;
+		unsigned int splitCount;
+		unsigned int iteration;
+		std::vector<Node> nodes;
+		std::vector<Region> regions;
+	};
+
+	// impl ---------------------------------
+
+	template<class T>
+	inline BasicDirectionTree<T>::BasicDirectionTree() : nodes(1, Node{ { T(0), T(0), T(0), T(0) }, { T(1), T(1), T(1), T(1) }, { 0, 0, 0, 0 } })
+	{
+	}
+
+	template<class T>
+	inline void BasicDirectionTree<T>::toSquare(Vector<T, 3> direction, T& u, T& v)
+	{
+		const T pi = T(3.141592653589793);
+		u = (std::min)((std::max)((direction(2) + T(1)) * T(0.5), T(0)), T(1));
+		v = std::atan2(direction(1), direction(0)) * (T(0.5) / pi);
+		if (v < 0)
+			v += T(1);
+	}
+
+	template<class T>
+	inline Vector<T, 3> BasicDirectionTree<T>::fromSquare(T u, T v)
+	{
+		const T pi = T(3.141592653589793);
+		T cosTheta = T(2) * u - T(1);
+		T sinTheta = std::sqrt((std::max)(T(0), T(1) - cosTheta * cosTheta));
+		T phi = T(2) * pi * v;
+		return { sinTheta * std::cos(phi), sinTheta * std::sin(phi), cosTheta };
+	}
+
+	template<class T>
+	inline void BasicDirectionTree<T>::record(Vector<T, 3> direction, T value)
+	{
+		T u, v;
+		toSquare(direction, u, v);
+		unsigned int node = 0;
+		while (true)
+		{
+			unsigned int x = u >= T(0.5);
+			unsigned int y = v >= T(0.5);
+			unsigned int quadrant = x + 2 * y;
+			nodes[node].sum[quadrant] += value;
+			node = nodes[node].child[quadrant];
+			if (node == 0)
+				break;
+			u = u * 2 - x;
+			v = v * 2 - y;
+		}
+	}
+
+	template<class T>
+	inline Vector<T, 3> BasicDirectionTree<T>::sample(T u1, T u2, T& pdf) const
+	{
+		const T pi = T(3.141592653589793);
+		// erst die spalte mit u1, dann die zeile darin mit u2 waehlen, so verbraucht jede ebene von beiden zahlen nur ein bit
+		T originU = 0, originV = 0, size = 1;
+		T density = 1;
+		unsigned int node = 0;
+		while (true)
+		{
+			const T (&sum)[4] = nodes[node].sum;
+			T total = sum[0] + sum[1] + sum[2] + sum[3];
+			if (total <= 0)
+				break;
+
+			T left = (sum[0] + sum[2]) / total;
+			unsigned int x = u1 >= left;
+			u1 = x ? (u1 - left) / (T(1) - left) : u1 / left;
+			T column = x ? sum[1] + sum[3] : sum[0] + sum[2];
+			T bottom = (x ? sum[1] : sum[0]) / column;
+			unsigned int y = u2 >= bottom;
+			u2 = y ? (u2 - bottom) / (T(1) - bottom) : u2 / bottom;
+
+			unsigned int quadrant = x + 2 * y;
+			density *= nodes[node].density[quadrant];
+			size *= T(0.5);
+			originU += x * size;
+			originV += y * size;
+			node = nodes[node].child[quadrant];
+			if (node == 0)
+				break;
+		}
+		u1 = (std::min)(u1, T(1));
+		u2 = (std::min)(u2, T(1));
+		pdf = density / (T(4) * pi);
+		return fromSquare(originU + u1 * size, originV + u2 * size);
+	}
+
+	template<class T>
+	inline T BasicDirectionTree<T>::pdf(Vector<T, 3> direction) const
+	{
+		const T pi = T(3.141592653589793);
+		T u, v;
+		toSquare(direction, u, v);
+		T density = 1;
+		unsigned int node = 0;
+		while (true)
+		{
+			unsigned int x = u >= T(0.5);
+			unsigned int y = v >= T(0.5);
+			unsigned int quadrant = x + 2 * y;
+			density *= nodes[node].density[quadrant];
+			node = nodes[node].child[quadrant];
+			if (node == 0 || density == 0)
+				break;
+			u = u * 2 - x;
+			v = v * 2 - y;
+		}
+		return density / (T(4) * pi);
+	}
+
+	template<class T>
+	inline void BasicDirectionTree<T>::prepare()
+	{
+		// knoten ohne licht bleiben gleichverteilt, wie in sample
+		for (Node& node : nodes)
+		{
+			T total = node.sum[0] + node.sum[1] + node.sum[2] + node.sum[3];
+			for (unsigned int quadrant = 0; quadrant < 4; quadrant++)
+				node.density[quadrant] = total > 0 ? T(4) * node.sum[quadrant] / total : T(1);
+		}
+	}
+
+	template<class T>
+	inline T BasicDirectionTree<T>::getTotal() const
+	{
+		const T (&sum)[4] = nodes[0].sum;
+		return sum[0] + sum[1] + sum[2] + sum[3];
+	}
+
+	template<class T>
+	inline unsigned int BasicDirectionTree<T>::getNodeCount() const
+	{
+		return nodes.size();
+	}
+
+	template<class T>
+	inline BasicDirectionTree<T> BasicDirectionTree<T>::refine(T fraction, unsigned int maxDepth) const
+	{
+		BasicDirectionTree<T> result;
+		T total = getTotal();
+		if (total > 0)
+			refineNode(0, nodes[0].sum, 0, 1, fraction * total, maxDepth, result);
+		return result;
+	}
+
+	template<class T>
+	inline void BasicDirectionTree<T>::refineNode(int node, const T (&sums)[4], unsigned int target, unsigned int depth, T limit, unsigned int maxDepth, BasicDirectionTree<T>& result) const
+	{
+		if (depth >= maxDepth)
+			return;
+		for (unsigned int quadrant = 0; quadrant < 4; quadrant++)
+		{
+			if (sums[quadrant] <= limit)
+				continue;
+
+			// war die zelle bisher ein blatt, wird ihr licht gleichmaessig auf die neuen viertel verteilt
+			int child = node >= 0 ? int(nodes[node].child[quadrant]) : 0;
+			T quarter = sums[quadrant] / 4;
+			T childSums[4] = { quarter, quarter, quarter, quarter };
+			if (child != 0)
+				std::copy(nodes[child].sum, nodes[child].sum + 4, childSums);
+			else
+				child = -1;
+
+			unsigned int index = result.nodes.size();
+			result.nodes.push_back(Node{ { T(0), T(0), T(0), T(0) }, { T(1), T(1), T(1), T(1) }, { 0, 0, 0, 0 } });
+			result.nodes[target].child[quadrant] = index;
+			refineNode(child, childSums, index, depth + 1, limit, maxDepth, result);
+		}
+	}
+
+	template<class T>
+	inline BasicPathGuide<T>::BasicPathGuide(AABB<T> bounds, unsigned int splitCount) : splitCount(splitCount), iteration(0)
+	{
+		// wuerfel um die szene, damit die raeumlichen zellen durch das abwechselnde halbieren nicht lang und duenn werden
+		if (bounds.isEmpty())
+			bounds = AABB<T>({ T(-1), T(-1), T(-1) }, { T(1), T(1), T(1) });
+		Vector<T, 3> center = bounds.getCenter();
+		Vector<T, 3> extent = bounds.max - bounds.min;
+		T half = (std::max)({ extent(0), extent(1), extent(2), T(1e-3) }) * T(0.5);
+		this->bounds = AABB<T>({ center(0) - half, center(1) - half, center(2) - half }, { center(0) + half, center(1) + half, center(2) + half });
+
+		nodes.push_back(Node{ 0, { 0, 0 }, 0 });
+		regions.push_back(Region{ BasicDirectionTree<T>(), BasicDirectionTree<T>(), 0 });
+	}
+
+	template<class T>
+	inline unsigned int BasicPathGuide<T>::findRegion(Vector<T, 3> position) const
+	{
+		Vector<T, 3> min = bounds.min;
+		Vector<T, 3> max = bounds.max;
+		unsigned int node = 0;
+		// punkte ausserhalb (z.b. weit draussen auf der ebene) landen in der naechsten randzelle
+		while (nodes[node].child[0] != 0)
+		{
+			unsigned int axis = nodes[node].axis;
+			T middle = (min(axis) + max(axis)) * T(0.5);
+			if (position(axis) < middle)
+			{
+				max(axis) = middle;
+				node = nodes[node].child[0];
+			}
+			else
+			{
+				min(axis) = middle;
+				node = nodes[node].child[1];
+			}
+		}
+		return nodes[node].region;
+	}
+
+	template<class T>
+	inline void BasicPathGuide<T>::record(const GuidingRecord<T>& record)
+	{
+		Vector<T, 3> radiance = record.radiance;
+		T luminance = T(0.2126) * radiance(0) + T(0.7152) * radiance(1) + T(0.0722) * radiance(2);
+		Region& region = regions[findRegion(record.position)];
+		region.count++;
+		if (luminance > 0 && record.pdf > 0)
+			region.recording.record(record.direction, luminance / record.pdf);
+	}
+
+	template<class T>
+	inline void BasicPathGuide<T>::update()
+	{
+		// raeumlich teilen, die kinder erben den quadtree und die haelfte der eintraege, bis alle unter der schwelle liegen
+		double threshold = splitCount * std::sqrt(std::pow(2.0, iteration));
+		for (unsigned int node = 0; node < nodes.size(); node++)
+		{
+			if (nodes[node].child[0] != 0 || regions[nodes[node].region].count <= threshold)
+				continue;
+
+			unsigned int region = nodes[node].region;
+			regions[region].count /= 2;
+			unsigned int axis = nodes[node].axis;
+			nodes[node].child[0] = nodes.size();
+			nodes[node].child[1] = nodes.size() + 1;
+			nodes.push_back(Node{ (axis + 1) % 3, { 0, 0 }, region });
+			nodes.push_back(Node{ (axis + 1) % 3, { 0, 0 }, (unsigned int)regions.size() });
+			regions.push_back(regions[region]);
+			// die neuen knoten kommen spaeter in dieser schleife noch dran und werden bei bedarf weiter geteilt
+		}
+
+		for (Region& region : regions)
+		{
+			region.sampling = std::move(region.recording);
+			region.sampling.prepare();
+			region.recording = region.sampling.refine(T(0.01), 20);
+			region.count = 0;
+		}
+		iteration++;
+	}
+
+	template<class T>
+	inline const BasicDirectionTree<T>* BasicPathGuide<T>::getDistribution(Vector<T, 3> position) const
+	{
+		if (iteration == 0)
+			return nullptr;
+		const Region& region = regions[findRegion(position)];
+		return region.sampling.getTotal() > 0 ? &region.sampling : nullptr;
+	}
+
+	template<class T>
+	inline unsigned int BasicPathGuide<T>::getIteration() const
+	{
+		return iteration;
+	}
+
+	template<class T>
+	inline unsigned int BasicPathGuide<T>::getRegionCount() const
+	{
+		return regions.size();
+	}
+
+	template<class T>
+	inline unsigned int BasicPathGuide<T>::getDirectionNodeCount() const
+	{
+		unsigned int count = 0;
+		for (const Region& region : regions)
+			count += region.sampling.getNodeCount();
+		return count;
+	}
+}
@@ -1,8 +1,24 @@
 #include "Matrix.h"
 #include "Bitmap.h"
-
-#include <random>
+#include "TileScheduler.h"
+#include "TileNetwork.h"
+#include "Random.h"
+#include "BVH.h"
+
+#include <limits>
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <memory>
 #include <thread>
+#include <functional>
+#include <cstdlib>
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
 
 using namespace cg;
 
@@ -24,22 +40,38 @@ namespace path
 		};
 	}
 
+	class RayTraceObject;
+
+	// naechster treffer eines strahls, wird von intersect nur ueberschrieben wenn ein naeherer treffer gefunden wurde
+	struct Hit
+	{
+		double distance;
+		RayTraceObject* object;
+		Vector<double, 3> normal;
+	};
+
 	class RayTraceObject
 	{
 	public:
-		virtual std::vector<std::tuple<double, RayTraceObject*, Vector<double, 3>>> getDistance(Vector<double, 3> origin, Vector<double, 3> direction) { return {}; };
+		// sucht den naechsten treffer mit tmin < distanz < tmax, allokiert nichts
+		virtual bool intersect(Vector<double, 3> origin, Vector<double, 3> direction, double tmin, double tmax, Hit& hit) { return false; };
+		// unbeschraenkte objekte (z.b. die ebene) geben false zurueck und landen nicht in der BVH
+		virtual bool getBounds(AABB<double>& bounds) { return false; };
 		Vector<unsigned char, 3> color;
 	};
 
 	class TestPlane : public RayTraceObject
 	{
 	public:
-		std::vector<std::tuple<double, RayTraceObject*, Vector<double, 3>>> getDistance(Vector<double, 3> origin, Vector<double, 3> direction)
+		bool intersect(Vector<double, 3> origin, Vector<double, 3> direction, double tmin, double tmax, Hit& hit)
 		{
-			std::vector<std::tuple<double, RayTraceObject*, Vector<double, 3>>> list;
-			if (direction(1) != 0)
-				list.push_back({ -(origin(1) / direction(1)), this, {0.0, 1.0, 0.0} });
-			return list;
+			if (direction(1) == 0)
+				return false;
+			double distance = -(origin(1) / direction(1));
+			if (distance <= tmin || distance >= tmax)
+				return false;
+			hit = { distance, this, {0.0, 1.0, 0.0} };
+			return true;
 		};
 	};
 
@@ -48,65 +80,134 @@ namespace path
 	public:
 		double size;
 		Vector<double, 3> pos;
-		std::vector<std::tuple<double, RayTraceObject*, Vector<double, 3>>> getDistance(Vector<double, 3> origin, Vector<double, 3> direction)
+		bool intersect(Vector<double, 3> origin, Vector<double, 3> direction, double tmin, double tmax, Hit& hit)
 		{
-			std::vector<std::tuple<double, RayTraceObject*, Vector<double, 3>>> list;
-
-			double discriminant = (2.0 * direction * (origin - pos)) * (direction * (origin - pos) * 2) - (4.0 * direction * direction * (origin * origin + pos * pos - size * size - 2 * (origin * pos)));
-
-			if (discriminant >= 0)
+			Vector<double, 3> offset = origin - pos;
+			double a = direction * direction;
+			double b = direction * offset;
+			double c = offset * offset - size * size;
+			double discriminant = b * b - a * c;
+			if (discriminant < 0)
+				return false;
+
+			double root = std::sqrt(discriminant);
+			double distance = (-b - root) / a;
+			if (distance <= tmin || distance >= tmax)
 			{
-				double distance1 = (-2.0 * direction * (origin - pos) + std::sqrt(discriminant)) / (2.0 * direction * direction);
-				double distance2 = (-2.0 * direction * (origin - pos) - std::sqrt(discriminant)) / (2.0 * direction * direction);
-				Vector<double, 3> normal1 = origin + distance1 * direction - pos;
-				Vector<double, 3> normal2 = origin + distance2 * direction - pos;
-				list.push_back({ distance1, this, normal1 });
-				list.push_back({ distance2, this, normal2 });
+				distance = (-b + root) / a;
+				if (distance <= tmin || distance >= tmax)
+					return false;
 			}
+			hit = { distance, this, offset + distance * direction };
+			return true;
+		};
 
-			return list;
+		bool getBounds(AABB<double>& bounds)
+		{
+			bounds = AABB<double>({ pos(0) - size, pos(1) - size, pos(2) - size }, { pos(0) + size, pos(1) + size, pos(2) + size });
+			return true;
 		};
 	};
 
-	std::tuple<double, RayTraceObject*, Vector<double, 3>> getClosestObject(std::vector<std::tuple<double, RayTraceObject*, Vector<double, 3>>> list)
+	// szene mit BVH fuer die beschraenkten objekte, nach add() und nach dem verschieben von objekten muss build() aufgerufen werden
+	class Scene
 	{
-		double distance = -1;
-		RayTraceObject* closest = nullptr;
-		Vector<double, 3> normal;
-		for (auto e : list)
+	public:
+		void add(RayTraceObject* object)
+		{
+			AABB<double> bounds;
+			if (object->getBounds(bounds))
+				objects.push_back(object);
+			else
+				unbounded.push_back(object);
+		}
+
+		void build()
 		{
-			if ((std::get<0>(e) < distance && std::get<0>(e) > 0) || distance < 0)
+			std::vector<AABB<double>> bounds(objects.size());
+			for (unsigned int i = 0; i < objects.size(); i++)
+				objects[i]->getBounds(bounds[i]);
+			bvh.build(bounds);
+
+			// objekte in blattreihenfolge bringen, damit ein blatt direkt einen bereich von objects abdeckt
+			std::vector<RayTraceObject*> sorted(objects.size());
+			for (unsigned int i = 0; i < objects.size(); i++)
+				sorted[i] = objects[bvh.getIndices()[i]];
+			objects = sorted;
+		}
+
+		bool trace(Vector<double, 3> origin, Vector<double, 3> direction, Hit& hit) const
+		{
+			double tmax = std::numeric_limits<double>::max();
+			bool found = false;
+			for (auto e : unbounded)
 			{
-				distance = std::get<0>(e);
-				closest = std::get<1>(e);
-				normal = std::get<2>(e);
+				if (e->intersect(origin, direction, 0, tmax, hit))
+				{
+					tmax = hit.distance;
+					found = true;
+				}
 			}
-		}
-		if (distance > 0)
-			return { distance, closest, normal };
-		else
-			return { distance, nullptr, normal };
-	}
 
+			if (bvh.intersect(origin, direction, tmax, [&](unsigned int first, unsigned int count, double& limit)
+			{
+				bool hitLeaf = false;
+				for (unsigned int i = first; i < first + count; i++)
+				{
+					if (objects[i]->intersect(origin, direction, 0, limit, hit))
+					{
+						limit = hit.distance;
+						hitLeaf = true;
+					}
+				}
+				return hitLeaf;
+			}))
+				found = true;
+			return found;
+		}
 
-	std::tuple<double, RayTraceObject*, Vector<double, 3>> trace(Vector<double, 3> origin, Vector<double, 3> direction, std::vector<RayTraceObject*> scene)
-	{
-		std::vector<std::tuple<double, RayTraceObject*, Vector<double, 3>>> list;
-		for (auto e : scene)
+		// bricht beim ersten treffer mit 0 < distanz < tmax ab
+		bool occluded(Vector<double, 3> origin, Vector<double, 3> direction, double tmax) const
 		{
-			auto elems = e->getDistance(origin, direction);
-			list.insert(list.end(), elems.begin(), elems.end());
+			Hit hit;
+			for (auto e : unbounded)
+				if (e->intersect(origin, direction, 0, tmax, hit))
+					return true;
+
+			return bvh.occluded(origin, direction, tmax, [&](unsigned int first, unsigned int count, double& limit)
+			{
+				for (unsigned int i = first; i < first + count; i++)
+					if (objects[i]->intersect(origin, direction, 0, limit, hit))
+						return true;
+				return false;
+			});
 		}
-		return getClosestObject(list);
+	private:
+		std::vector<RayTraceObject*> objects;
+		std::vector<RayTraceObject*> unbounded;
+		BVH<double> bvh;
+	};
+
+	bool trace(Vector<double, 3> origin, Vector<double, 3> direction, const Scene& scene, Hit& hit)
+	{
+		return scene.trace(origin, direction, hit);
 	}
 
-	std::tuple<double, RayTraceObject*, Vector<double, 3>, Vector<double, 3>> tracePlus(Vector<double, 3> origin, Vector<double, 3> direction, std::vector<RayTraceObject*> scene)
+	// bricht beim ersten treffer mit 0 < distanz < tmax ab, fuer AO strahlen reicht die sichtbarkeit
+	bool occluded(Vector<double, 3> origin, Vector<double, 3> direction, const Scene& scene, double tmax)
 	{
-		auto [distance, object, normal] = trace(origin, direction, scene);
-		normal = normalize(normal);
-		Vector<double, 3> pos = origin + distance * direction;
+		return scene.occluded(origin, direction, tmax);
+	}
+
+	std::tuple<double, RayTraceObject*, Vector<double, 3>, Vector<double, 3>> tracePlus(Vector<double, 3> origin, Vector<double, 3> direction, const Scene& scene)
+	{
+		Hit hit;
+		if (!trace(origin, direction, scene, hit))
+			return { -1, nullptr, {}, origin };
+		Vector<double, 3> normal = normalize(hit.normal);
+		Vector<double, 3> pos = origin + hit.distance * direction;
 		pos = pos + normal * 0.000001; // delta wert um nicht das gleiche objekt am gleichen ort wieder zu treffen
-		return { distance, object, normal, pos };
+		return { hit.distance, hit.object, normal, pos };
 	}
 
 	double dot(Vector<double, 3> v1, Vector<double, 3> v2)
@@ -114,35 +215,262 @@ namespace path
 		return v1(0) * v2(0) + v1(1) * v2(1) + v1(2) * v2(2);
 	}
 
-	// 
-	Vector<double, 3> randomHemisphere(Vector<double, 3> normal)
+	// kosinusgewichtet wie path2::randomHemisphere (Malley): gleichverteilt auf der kreisscheibe und auf die halbkugel hochprojiziert
+	// getColor zaehlt die unverdeckten strahlen und bekommt so ohne weitere gewichte den kosinusgewichteten anteil
+	Vector<double, 3> randomHemisphere(Vector<double, 3> normal, Random& random)
 	{
 		const double pi = 3.141592653589793;
-		static std::uniform_real_distribution<double> random(0, 1.0);
-		static std::default_random_engine generator;
 
-		double angle1 = random(generator) * pi * 2;
-		double angle2 = random(generator) * pi;
+		double u1 = random.next();
+		double u2 = random.next();
+		double radius = std::sqrt(u1);
+		double angle = 2 * pi * u2;
+		double z = std::sqrt((std::max)(0.0, 1 - u1));
 
+		// orthonormalbasis ohne verzweigung (Duff et al. 2017)
 		normal = normalize(normal);
+		double sign = std::copysign(1.0, normal(2));
+		double a = -1 / (sign + normal(2));
+		double b = normal(0) * normal(1) * a;
+		Vector<double, 3> tangent = { 1 + sign * normal(0) * normal(0) * a, sign * b, -sign * normal(0) };
+		Vector<double, 3> bitangent = { b, sign + normal(1) * normal(1) * a, -normal(1) };
 
-		//Vector<double, 3> vec = { std::sin(angle1) * std::sin(angle2), std::cos(angle1) * std::sin(angle2), std::cos(angle2) };
-		//
-		//double angle = vec * normal;
-		//if (angle < 0)
-		//{
-		//	// funktioniert nicht
-		//	vec = vec - normal * angle * 2;
-		//}
-		//else
+		return tangent * (radius * std::cos(angle)) + bitangent * (radius * std::sin(angle)) + normal * z;
+	}
 
-		Vector<double, 3> rand = { 2 * (random(generator) - 0.5), 2 * (random(generator) - 0.5), 2 * (random(generator) - 0.5) };
-		Vector<double, 3> vec = normalize(normal + normalize(rand));
+	// eintrag des irradiance cache (Ward 1988): kosinusgewichteter anteil des unverdeckten himmels an einem punkt
+	// dazu die ableitungen nach drehung der normale und verschiebung des punkts (Ward und Heckbert 1992), damit die interpolation glatt bleibt
+	struct IrradianceRecord
+	{
+		Vector<double, 3> position;
+		Vector<double, 3> normal;
+		double irradiance;
+		// gueltigkeitsradius, harmonisches mittel der trefferdistanzen
+		double radius;
+		Vector<double, 3> rotationGradient;
+		Vector<double, 3> translationGradient;
+	};
 
-		return vec;
-	}
+	// nur an wenigen punkten wird die ganze hemisphaere abgetastet, dazwischen wird aus den eintraegen mit ihren gradienten interpoliert
+	// ein eintrag gilt fuer einen punkt, wenn der fehler |p - p_i| / R_i + sqrt(1 - n * n_i) kleiner als accuracy ist
+	// die eintraege liegen in einem octree, jeder im tiefsten knoten dessen halbe kantenlaenge noch mindestens accuracy * R_i ist,
+	// eine suche besucht dann nur knoten, deren um die halbe kante vergroesserte box den punkt enthaelt
+	// die wurzel waechst nach aussen wenn ein eintrag ausserhalb liegt oder ihre halbe kante kleiner als accuracy * R_i ist, die ebene ist unendlich gross
+	// lookup und gather lesen nur und duerfen parallel laufen, insert nicht; fillIrradianceCache fuegt darum nur zwischen den parallelen
+	// abschnitten und in fester reihenfolge ein, damit das bild nicht davon abhaengt, welche kachel zuerst fertig ist
+	class IrradianceCache
+	{
+	public:
+		// die radien werden auf minPixels bis maxPixels pixelbreiten am punkt begrenzt, sonst gibt es am horizont einen eintrag pro pixel
+		// und an kontaktstellen unendlich viele
+		IrradianceCache(double accuracy = 0.25, double minPixels = 3, double maxPixels = 60, unsigned int thetaCount = 8, unsigned int phiCount = 32)
+			: accuracy(accuracy), minPixels(minPixels), maxPixels(maxPixels), thetaCount(thetaCount), phiCount(phiCount), recordCount(0)
+		{
+		}
+
+		// gewichtetes mittel aller gueltigen eintraege, false wenn keiner gilt
+		bool lookup(Vector<double, 3> position, Vector<double, 3> normal, double& irradiance) const
+		{
+			double weightSum = 0;
+			double valueSum = 0;
+			if (root)
+				lookup(root.get(), position, normal, weightSum, valueSum);
+			if (weightSum == 0)
+				return false;
+			irradiance = (std::min)((std::max)(valueSum / weightSum, 0.0), 1.0);
+			return true;
+		}
+
+		// tastet die hemisphaere in thetaCount x phiCount schichten kosinusgewichtet ab und berechnet einen eintrag, ohne ihn einzufuegen
+		// footprint ist die breite eines pixels am punkt, das ergebnis haengt nur vom punkt und vom pixel ab
+		IrradianceRecord gather(Vector<double, 3> position, Vector<double, 3> normal, double footprint, const Scene& scene, unsigned int pixel) const
+		{
+			const double pi = 3.141592653589793;
+			const double infinity = std::numeric_limits<double>::infinity();
+			Vector<double, 3> tangent = normalize(cross(std::abs(normal(0)) < 0.9 ? Vector<double, 3>{ 1.0, 0.0, 0.0 } : Vector<double, 3>{ 0.0, 1.0, 0.0 }, normal));
+			Vector<double, 3> bitangent = cross(normal, tangent);
+			auto inPlane = [&](double phi) { return tangent * std::cos(phi) + bitangent * std::sin(phi); };
+
+			// sin(theta_j) = sqrt((j + u) / M), phi_k = 2 pi (k + v) / N, damit ist jede schicht gleich wahrscheinlich
+			const unsigned int count = thetaCount * phiCount;
+			std::vector<double> radiance(count);
+			std::vector<double> distance(count);
+			double irradiance = 0;
+			double inverseDistanceSum = 0;
+			Vector<double, 3> rotationGradient = { 0.0, 0.0, 0.0 };
+			for (unsigned int k = 0; k < phiCount; k++)
+			{
+				double tangentSum = 0;
+				for (unsigned int j = 0; j < thetaCount; j++)
+				{
+					Random random(pixel, j * phiCount + k);
+					double sinTheta = std::sqrt((j + random.next()) / thetaCount);
+					double cosTheta = std::sqrt((std::max)(0.0, 1 - sinTheta * sinTheta));
+					double phi = 2 * pi * (k + random.next()) / phiCount;
+					Vector<double, 3> direction = inPlane(phi) * sinTheta + normal * cosTheta;
+
+					Hit hit;
+					unsigned int index = j * phiCount + k;
+					radiance[index] = trace(position, direction, scene, hit) ? 0.0 : 1.0;
+					distance[index] = radiance[index] == 0 ? hit.distance : infinity;
+					irradiance += radiance[index];
+					inverseDistanceSum += 1 / distance[index];
+					tangentSum -= sinTheta / (std::max)(cosTheta, 1e-3) * radiance[index];
+				}
+				rotationGradient = rotationGradient + inPlane(2 * pi * k / phiCount + pi / 2) * tangentSum;
+			}
+
+			// verschiebung: an den grenzen zwischen benachbarten schichten aendert sich der raumwinkel mit der distanz des naeheren treffers
+			Vector<double, 3> translationGradient = { 0.0, 0.0, 0.0 };
+			for (unsigned int k = 0; k < phiCount; k++)
+			{
+				unsigned int previous = (k + phiCount - 1) % phiCount;
+				double radialSum = 0;
+				double azimuthalSum = 0;
+				for (unsigned int j = 0; j < thetaCount; j++)
+				{
+					unsigned int index = j * phiCount + k;
+					double sinLower = std::sqrt(double(j) / thetaCount);
+					double sinUpper = std::sqrt(double(j + 1) / thetaCount);
+					if (j > 0)
+					{
+						unsigned int below = index - phiCount;
+						radialSum += sinLower * (1 - sinLower * sinLower) / (std::min)(distance[index], distance[below]) * (radiance[index] - radiance[below]);
+					}
+					unsigned int side = j * phiCount + previous;
+					azimuthalSum += (sinUpper - sinLower) / (std::min)(distance[index], distance[side]) * (radiance[index] - radiance[side]);
+				}
+				double phi = 2 * pi * k / phiCount;
+				translationGradient = translationGradient + inPlane(phi + pi / phiCount) * (2 * pi / phiCount * radialSum) + inPlane(phi + pi / 2) * azimuthalSum;
+			}
+
+			// alles relativ zu pi, der unverdeckte himmel hat irradiance 1
+			IrradianceRecord record;
+			record.position = position;
+			record.normal = normal;
+			record.irradiance = irradiance / count;
+			record.rotationGradient = rotationGradient / double(count);
+			record.translationGradient = translationGradient / pi;
+			record.radius = inverseDistanceSum > 0 ? count / inverseDistanceSum : infinity;
+			// steile gradienten verkuerzen den radius, sonst laeuft die lineare extrapolation aus dem wertebereich
+			double gradientLength = std::sqrt(dot(record.translationGradient, record.translationGradient));
+			if (gradientLength > 0)
+				record.radius = (std::min)(record.radius, record.irradiance / gradientLength);
+			record.radius = (std::min)((std::max)(record.radius, minPixels * footprint), maxPixels * footprint);
+			return record;
+		}
+
+		void insert(const IrradianceRecord& record)
+		{
+			double influence = accuracy * record.radius;
+			if (!root)
+			{
+				root = std::make_unique<Node>();
+				root->center = record.position;
+				root->halfSize = influence;
+			}
+			// die suche findet einen eintrag nur in knoten mit halber kante >= accuracy * R_i, das gilt auch fuer die wurzel
+			while (!contains(*root, record.position, root->halfSize) || root->halfSize < influence)
+			{
+				// neue wurzel mit doppelter kante, die alte wird das kind auf der abgewandten seite
+				std::unique_ptr<Node> grown = std::make_unique<Node>();
+				Vector<double, 3> center = root->center;
+				Vector<double, 3> position = record.position;
+				for (unsigned int i = 0; i < 3; i++)
+					center(i) += position(i) > center(i) ? root->halfSize : -root->halfSize;
+				grown->center = center;
+				grown->halfSize = root->halfSize * 2;
+				unsigned int index = octant(*grown, root->center);
+				grown->children[index] = std::move(root);
+				root = std::move(grown);
+			}
+
+			Node* node = root.get();
+			while (node->halfSize / 2 >= influence)
+			{
+				unsigned int index = octant(*node, record.position);
+				if (!node->children[index])
+				{
+					node->children[index] = std::make_unique<Node>();
+					Vector<double, 3> center = node->center;
+					for (unsigned int i = 0; i < 3; i++)
+						center(i) += index & (1 << i) ? node->halfSize / 2 : -node->halfSize / 2;
+					node->children[index]->center = center;
+					node->children[index]->halfSize = node->halfSize / 2;
+				}
+				node = node->children[index].get();
+			}
+			node->records.push_back(record);
+			recordCount++;
+		}
+
+		unsigned int getRecordCount() const
+		{
+			return recordCount;
+		}
+	private:
+		struct Node
+		{
+			Vector<double, 3> center;
+			double halfSize;
+			std::vector<IrradianceRecord> records;
+			std::unique_ptr<Node> children[8];
+		};
+
+		static unsigned int octant(const Node& node, Vector<double, 3> position)
+		{
+			Vector<double, 3> center = node.center;
+			return (position(0) > center(0) ? 1 : 0) | (position(1) > center(1) ? 2 : 0) | (position(2) > center(2) ? 4 : 0);
+		}
+
+		static bool contains(const Node& node, Vector<double, 3> position, double halfSize)
+		{
+			Vector<double, 3> center = node.center;
+			for (unsigned int i = 0; i < 3; i++)
+				if (std::abs(position(i) - center(i)) > halfSize)
+					return false;
+			return true;
+		}
+
+		void lookup(const Node* node, Vector<double, 3> position, Vector<double, 3> normal, double& weightSum, double& valueSum) const
+		{
+			if (!contains(*node, position, node->halfSize * 2))
+				return;
+			for (const IrradianceRecord& record : node->records)
+			{
+				Vector<double, 3> offset = position - record.position;
+				double distanceSquared = dot(offset, offset);
+				double limit = accuracy * record.radius;
+				if (distanceSquared >= limit * limit)
+					continue;
+				Vector<double, 3> recordNormal = record.normal;
+				double error = std::sqrt(distanceSquared) / record.radius + std::sqrt((std::max)(0.0, 1 - dot(normal, recordNormal)));
+				if (error >= accuracy)
+					continue;
+				// liegt der eintrag vor der tangentialebene des punkts, sieht er eine andere umgebung
+				if (dot(offset, recordNormal + normal) < -0.02 * record.radius)
+					continue;
+				double weight = 1 / (std::max)(error, 1e-9);
+				double value = record.irradiance + dot(cross(recordNormal, normal), record.rotationGradient) + dot(offset, record.translationGradient);
+				weightSum += weight;
+				valueSum += weight * value;
+			}
+			for (const std::unique_ptr<Node>& child : node->children)
+				if (child)
+					lookup(child.get(), position, normal, weightSum, valueSum);
+		}
 
-	Vector<unsigned char, 3> getColor(Vector<double, 3> origin, Vector<double, 3> dest, std::vector<RayTraceObject*> scene)
+		double accuracy;
+		double minPixels, maxPixels;
+		unsigned int thetaCount, phiCount;
+		std::unique_ptr<Node> root;
+		unsigned int recordCount;
+	};
+
+	// mit cache wird das licht interpoliert, pixelSize ist die pixelbreite auf der bildebene
+	// gilt kein eintrag, wird fuer den pixel einer berechnet aber nicht eingefuegt, der cache bleibt waehrend des bildes unveraendert
+	// ohne cache schiesst jeder pixel samples strahlen in die hemisphaere
+	Vector<unsigned char, 3> getColor(Vector<double, 3> origin, Vector<double, 3> dest, const Scene& scene, unsigned int pixel, const IrradianceCache* cache = nullptr, double pixelSize = 0, unsigned int samples = 16)
 	{
 		Vector<double, 3> direction = normalize(dest - origin);
 
@@ -154,17 +482,26 @@ namespace path
 		{
 			color = { 255, 255, 255 };
 		}
+		else if (cache != nullptr)
+		{
+			double lightIntensity;
+			if (!cache->lookup(pos1, normal1, lightIntensity))
+			{
+				double footprint = distance1 * pixelSize / std::sqrt(dot(dest - origin, dest - origin));
+				lightIntensity = cache->gather(pos1, normal1, footprint, scene, pixel).irradiance;
+			}
+			color = { object1->color(0) * lightIntensity, object1->color(1) * lightIntensity, object1->color(2) * lightIntensity };
+		}
 		else
 		{
 			double lightIntensity = 0;
 			double lightStrength = 0;
-			const int samples = 16;
 
-			for (int i = 0; i < samples; i++)
+			for (unsigned int i = 0; i < samples; i++)
 			{
-				Vector<double, 3> randomDir = randomHemisphere(normal1);
-				auto [distance2, object2, normal2, pos2] = tracePlus(pos1, randomDir, scene);
-				if (object2 == nullptr)
+				Random random(pixel, i);
+				Vector<double, 3> randomDir = randomHemisphere(normal1, random);
+				if (!occluded(pos1, randomDir, scene, std::numeric_limits<double>::max()))
 				{
 					lightStrength += 1.0;
 					lightIntensity += 1.0;
@@ -184,14 +521,15 @@ namespace path
 		return color;
 	}
 
-	void run(unsigned int from, unsigned int to, Vector<double, 3> origin, Bitmap<unsigned char>* bitmap, std::vector<RayTraceObject*> scene)
+	void run(Tile tile, Vector<double, 3> origin, Bitmap<unsigned char>* bitmap, const Scene& scene, const IrradianceCache* cache, unsigned int samples = 16)
 	{
-		for (int i = from; i < to; i++)
+		auto [width, height] = bitmap->getSize();
+		for (unsigned int i = tile.x; i < tile.x + tile.width; i++)
 		{
-			for (int j = 0; j < 1000; j++)
+			for (unsigned int j = tile.y; j < tile.y + tile.height; j++)
 			{
-				Vector<double, 3> dest = { -i / 1000.0 + 0.5, 2.7 - j / 1000.0 + 0.5, 0 };
-				auto color = getColor(origin, dest, scene);
+				Vector<double, 3> dest = { -(i - width / 2.0) / height, 2.7 - (j - height / 2.0) / height, 0 };
+				auto color = getColor(origin, dest, scene, j * width + i, cache, 1.0 / height, samples);
 
 				(*bitmap)(i, j, 0) = color(0);
 				(*bitmap)(i, j, 1) = color(1);
@@ -201,47 +539,165 @@ namespace path
 		}
 	}
 
-	Bitmap<unsigned char> raytrace()
+	// fuellt den cache vor dem bild in durchgaengen mit pixelabstand 32, 16, ... 2
+	// in jedem durchgang suchen die kacheln parallel gegen den unveraenderten cache nach pixeln ohne gueltigen eintrag und berechnen dort einen,
+	// eingefuegt wird danach in pixelreihenfolge; die groben durchgaenge verhindern, dass benachbarte pixel doppelte eintraege anlegen
+	void fillIrradianceCache(IrradianceCache& cache, unsigned int width, unsigned int height, Vector<double, 3> origin, const Scene& scene, unsigned int threadCount)
 	{
-		Bitmap<unsigned char> bitmap(1000, 1000, 3);
-		bitmap.fill({ 0, 0, 0 });
+		for (unsigned int stride = 32; stride >= 2; stride /= 2)
+		{
+			unsigned int columns = (width + stride - 1) / stride;
+			unsigned int rows = (height + stride - 1) / stride;
+			std::vector<IrradianceRecord> records(columns * rows);
+			std::vector<char> found(columns * rows, 0);
 
-		TestPlane plane;
-		plane.color = { 255, 255, 255 };
+			TileScheduler scheduler(columns, rows, 8, threadCount);
+			scheduler.run([&](Tile tile)
+			{
+				for (unsigned int y = tile.y; y < tile.y + tile.height; y++)
+				{
+					for (unsigned int x = tile.x; x < tile.x + tile.width; x++)
+					{
+						unsigned int i = x * stride;
+						unsigned int j = y * stride;
+						Vector<double, 3> dest = { -(i - width / 2.0) / height, 2.7 - (j - height / 2.0) / height, 0 };
+						auto [distance, object, normal, pos] = tracePlus(origin, normalize(dest - origin), scene);
+						double irradiance;
+						if (object == nullptr || cache.lookup(pos, normal, irradiance))
+							continue;
+						double footprint = distance / height / std::sqrt(dot(dest - origin, dest - origin));
+						records[y * columns + x] = cache.gather(pos, normal, footprint, scene, j * width + i);
+						found[y * columns + x] = 1;
+					}
+				}
+			});
+
+			for (unsigned int index = 0; index < records.size(); index++)
+				if (found[index])
+					cache.insert(records[index]);
+		}
+	}
+
+	// ebene mit drei kugeln, gleich fuer raytrace und die worker von raytraceDistributed
+	struct TestScene
+	{
+		TestScene()
+		{
+			plane.color = { 255, 255, 255 };
+
+			sphere.color = { 200, 200, 255 };
+			sphere.size = 1;
+			sphere.pos = { 0.15, 1, 6.5 };
 
-		Sphere sphere;
-		sphere.color = { 200, 200, 255 };
-		sphere.size = 1;
-		sphere.pos = { 0.15, 1, 6.5 };
+			sphere2.color = { 255, 200, 200 };
+			sphere2.size = 0.75;
+			sphere2.pos = { -1, 0.75, 5.1 };
 
-		Sphere sphere2;
-		sphere2.color = { 255, 200, 200 };
-		sphere2.size = 0.75;
-		sphere2.pos = { -1, 0.75, 5.1 };
+			sphere3.color = { 200, 255, 200 };
+			sphere3.size = 0.5;
+			sphere3.pos = { 0.5, 0.5, 5 };
 
-		Sphere sphere3;
-		sphere3.color = { 200, 255, 200 };
-		sphere3.size = 0.5;
-		sphere3.pos = { 0.5, 0.5, 5 };
+			objects.add(&plane);
+			objects.add(&sphere);
+			objects.add(&sphere2);
+			objects.add(&sphere3);
+			objects.build();
+		}
+		TestScene(const TestScene&) = delete;
+
+		TestPlane plane;
+		Sphere sphere, sphere2, sphere3;
+		Scene objects;
+	};
 
-		std::vector<RayTraceObject*> scene;
-		scene.push_back(&plane);
-		scene.push_back(&sphere);
-		scene.push_back(&sphere2);
-		scene.push_back(&sphere3);
+	// ohne irradiance cache schiesst jeder pixel samples strahlen in die hemisphaere
+	// threadCount 0 nimmt alle kerne, das bild ist mit und ohne cache bei jeder threadzahl gleich
+	Bitmap<unsigned char> raytrace(unsigned int width = 1000, unsigned int height = 1000, bool irradianceCache = true, unsigned int threadCount = 0, unsigned int samples = 16)
+	{
+		Bitmap<unsigned char> bitmap(width, height, 3);
+		bitmap.fill({ 0, 0, 0 });
 
+		TestScene scene;
 		Vector<double, 3> origin = { 0, 3, -1 };
-		std::vector<std::thread> threads;
-		for (int i = 0; i < 8; i++)
+		IrradianceCache cache;
+		if (irradianceCache)
+			fillIrradianceCache(cache, width, height, origin, scene.objects, threadCount);
+		TileScheduler scheduler(width, height, 16, threadCount);
+		scheduler.run([&](Tile tile) { run(tile, origin, &bitmap, scene.objects, irradianceCache ? &cache : nullptr, samples); });
+		scheduler.printStatistics(std::cout);
+		if (irradianceCache)
+			std::cout << cache.getRecordCount() << " irradiance records" << std::endl;
+
+		return bitmap;
+	}
+
+	const unsigned short distributedPort = 47100;
+
+	// kamera fuer bild frame einer kurzen fahrt nach rechts, bild 0 ist die von raytrace
+	Vector<double, 3> getDistributedOrigin(unsigned int frame)
+	{
+		return { 0.25 * frame, 3, -1 };
+	}
+
+	// rendert kacheln fuer raytraceDistributed ohne irradiance cache, dessen eintraege pro prozess verschieden waeren
+	// dieAfter > 0 beendet den prozess nach so vielen kacheln, delay bremst jede kachel, beides nur zum testen der neuverteilung
+	bool renderWorker(const std::string& host, unsigned short port, unsigned int dieAfter = 0, double delay = 0)
+	{
+		TestScene scene;
+		TileWorker worker([&](TileJob job, Bitmap<unsigned char>& bitmap)
 		{
-			threads.push_back(std::thread(run, i * 125, i * 125 + 125, origin, &bitmap, scene));
-		}
-		for (int i = 0; i < 8; i++)
+			if (dieAfter > 0 && worker.getTileCount() + 1 == dieAfter)
+				std::_Exit(1);
+			if (delay > 0)
+				std::this_thread::sleep_for(std::chrono::duration<double>(delay));
+			run(job.tile, getDistributedOrigin(job.frame), &bitmap, scene.objects, nullptr);
+		});
+		return worker.run(host, port);
+	}
+
+	// wie raytrace ohne cache fuer frameCount bilder, aber die kacheln rendern eigene worker prozesse ueber tcp
+	// ausser unter windows startet die funktion workerCount worker selbst, jeder fuehrt worker(index, port) im kindprozess aus
+	// ohne worker laeuft renderWorker, weitere worker, auch auf anderen rechnern, koennen sich jederzeit mit main26 dazu verbinden
+	std::vector<Bitmap<unsigned char>> raytraceDistributed(unsigned int width = 1000, unsigned int height = 1000, unsigned int frameCount = 1, unsigned int workerCount = 4,
+		std::function<bool(unsigned int, unsigned short)> worker = nullptr)
+	{
+		if (!worker)
+			worker = [](unsigned int, unsigned short port) { return renderWorker("127.0.0.1", port); };
+
+		TileCoordinator coordinator(width, height, 3, 32, distributedPort);
+		coordinator.setTimeouts(4, 0.5, 10, 30);
+
+#ifdef _WIN32
+		std::cout << "waiting for workers on port " << coordinator.getPort() << " (main26)" << std::endl;
+		std::vector<int> children;
+#else
+		std::vector<pid_t> children;
+		for (unsigned int i = 0; i < workerCount; i++)
 		{
-			threads[i].join();
+			pid_t child = fork();
+			if (child == 0)
+			{
+				bool finished = worker(i, coordinator.getPort());
+				std::_Exit(finished ? 0 : 1);
+			}
+			if (child > 0)
+				children.push_back(child);
 		}
+#endif
 
-		return bitmap;
+		std::vector<Bitmap<unsigned char>> bitmaps(frameCount);
+		coordinator.run(frameCount, [&](unsigned int frame, Bitmap<unsigned char>& bitmap)
+		{
+			std::cout << "frame " << frame << " done" << std::endl;
+			bitmaps[frame] = bitmap;
+		});
+		coordinator.printStatistics(std::cout);
+
+#ifndef _WIN32
+		for (pid_t child : children)
+			waitpid(child, nullptr, 0);
+#endif
+		return bitmaps;
 	}
 }
 
@@ -254,5 +710,79 @@ int main4()
 	//bitmap.saveAsPPM("test.ppm");
 	bitmap.saveAsBMP("pathtrace.bmp");
 
+	return 0;
+}
+
+int main25()
+{
+	auto start = std::chrono::steady_clock::now();
+	// worker 0 stirbt nach ein paar kacheln und worker 1 ist langsam, damit neuverteilung und kopien etwas zu tun haben
+	auto bitmaps = path::raytraceDistributed(400, 400, 3, 4, [](unsigned int index, unsigned short port)
+	{
+		return path::renderWorker("127.0.0.1", port, index == 0 ? 10 : 0, index == 1 ? 1.0 : 0.0);
+	});
+	std::cout << "distributed in " << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << " s" << std::endl;
+	for (unsigned int i = 0; i < bitmaps.size(); i++)
+		bitmaps[i].saveAsBMP("distributed" + std::to_string(i) + ".bmp");
+
+	// bild 0 muss genau dem aus einem prozess entsprechen, die strahlen haengen nur vom pixel ab
+	start = std::chrono::steady_clock::now();
+	Bitmap<unsigned char> local = path::raytrace(400, 400, false);
+	std::cout << "local in " << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << " s" << std::endl;
+	unsigned long differences = 0;
+	for (unsigned long i = 0; i < local.getTotalSize(); i++)
+		differences += local.getData()[i] != bitmaps[0].getData()[i];
+	std::cout << differences << " bytes differ from the local render" << std::endl;
+
+	return 0;
+}
+
+// worker fuer main25, laeuft bis der coordinator fertig ist
+int main26()
+{
+	return path::renderWorker("127.0.0.1", path::distributedPort) ? 0 : 1;
+}
+
+// irradiance cache gegen den einfachen schaetzer, beide verglichen mit einem bild aus 1024 strahlen pro pixel
+// das bild mit cache muss ausserdem bei jeder threadzahl gleich sein
+int main27()
+{
+	const unsigned int width = 400;
+	const unsigned int height = 400;
+	auto rmse = [](Bitmap<unsigned char>& a, Bitmap<unsigned char>& b)
+	{
+		double sum = 0;
+		for (unsigned long i = 0; i < a.getTotalSize(); i++)
+			sum += (double(a.getData()[i]) - b.getData()[i]) * (double(a.getData()[i]) - b.getData()[i]);
+		return std::sqrt(sum / a.getTotalSize());
+	};
+	auto seconds = [](std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	};
+
+	Bitmap<unsigned char> reference = path::raytrace(width, height, false, 0, 1024);
+	for (unsigned int samples : { 16, 64, 256 })
+	{
+		auto start = std::chrono::steady_clock::now();
+		Bitmap<unsigned char> image = path::raytrace(width, height, false, 0, samples);
+		double time = seconds(start);
+		std::cout << samples << " spp: " << std::fixed << std::setprecision(2) << time << " s, rmse " << rmse(image, reference) << std::endl;
+	}
+
+	Bitmap<unsigned char> cached[2];
+	unsigned int threadCounts[2] = { 1, 4 };
+	for (unsigned int i = 0; i < 2; i++)
+	{
+		auto start = std::chrono::steady_clock::now();
+		cached[i] = path::raytrace(width, height, true, threadCounts[i]);
+		double time = seconds(start);
+		std::cout << "cache on " << threadCounts[i] << " threads: " << std::fixed << std::setprecision(2) << time << " s, rmse " << rmse(cached[i], reference) << std::endl;
+	}
+	unsigned long differences = 0;
+	for (unsigned long i = 0; i < cached[0].getTotalSize(); i++)
+		differences += cached[0].getData()[i] != cached[1].getData()[i];
+	std::cout << differences << " bytes differ between 1 and 4 threads" << std::endl;
+
 	return 0;
 }
\ No newline at end of file
@@ -1,150 +1,41 @@
-#include "Matrix.h"
-#include "Bitmap.h"
+#include "PathTracing2.h"
+#include "SceneFile.h"
 #include "Filters.h"
 
-#include <random>
-#include <thread>
+#include <iostream>
 
 using namespace cg;
 
 namespace path2
 {
-	template <class T, unsigned int N>
-	Vector<T, N> normalize(Vector<T, N> vec)
+	void getPixelOffset(unsigned int sample, Random& random, SampleSequence sequence, double& x, double& y)
 	{
-		return vec / (::sqrt(vec * vec) + 0.00001);
-	}
-
-	template <class T>
-	Vector<T, 3> cross(Vector<T, 3> v1, Vector<T, 3> v2)
-	{
-		return {
-			v1(1) * v2(2) - v1(2) * v2(1),
-			v1(2) * v2(0) - v1(0) * v2(2),
-			v1(0) * v2(1) - v1(1) * v2(0)
-		};
-	}
-
-	class RayTraceObject
-	{
-	public:
-		virtual std::vector<std::tuple<double, RayTraceObject*, Vector<double, 3>>> getDistance(Vector<double, 3> origin, Vector<double, 3> direction) { return {}; };
-		Vector<double, 3> color;
-		double transmission;
-	};
+		const unsigned int countX = 4;
+		const unsigned int countY = 4;
 
-	class TestPlane : public RayTraceObject
-	{
-	public:
-		std::vector<std::tuple<double, RayTraceObject*, Vector<double, 3>>> getDistance(Vector<double, 3> origin, Vector<double, 3> direction)
+		x = random.next();
+		y = random.next();
+		if (sequence != SampleSequence::Independent)
 		{
-			std::vector<std::tuple<double, RayTraceObject*, Vector<double, 3>>> list;
-			if (direction(1) != 0)
-				list.push_back({ -(origin(1) / direction(1)), this, {0.0, 1.0, 0.0} });
-			return list;
-		};
-	};
-
-	class Sphere : public RayTraceObject
-	{
-	public:
-		double size;
-		Vector<double, 3> pos;
-		std::vector<std::tuple<double, RayTraceObject*, Vector<double, 3>>> getDistance(Vector<double, 3> origin, Vector<double, 3> direction)
-		{
-			std::vector<std::tuple<double, RayTraceObject*, Vector<double, 3>>> list;
-
-			double discriminant = (2.0 * direction * (origin - pos)) * (direction * (origin - pos) * 2) - (4.0 * direction * direction * (origin * origin + pos * pos - size * size - 2 * (origin * pos)));
-
-			if (discriminant >= 0)
-			{
-				double distance1 = (-2.0 * direction * (origin - pos) + std::sqrt(discriminant)) / (2.0 * direction * direction);
-				double distance2 = (-2.0 * direction * (origin - pos) - std::sqrt(discriminant)) / (2.0 * direction * direction);
-				Vector<double, 3> normal1 = origin + distance1 * direction - pos;
-				Vector<double, 3> normal2 = origin + distance2 * direction - pos;
-				list.push_back({ distance1, this, normal1 });
-				list.push_back({ distance2, this, normal2 });
-			}
-
-			return list;
-		};
-	};
-
-	std::tuple<double, RayTraceObject*, Vector<double, 3>> getClosestObject(std::vector<std::tuple<double, RayTraceObject*, Vector<double, 3>>> list)
-	{
-		double distance = -1;
-		RayTraceObject* closest = nullptr;
-		Vector<double, 3> normal;
-		for (auto e : list)
-		{
-			if ((std::get<0>(e) < distance && std::get<0>(e) > 0) || distance < 0)
-			{
-				distance = std::get<0>(e);
-				closest = std::get<1>(e);
-				normal = std::get<2>(e);
-			}
+			x -= 0.5;
+			y -= 0.5;
+			return;
 		}
-		if (distance > 0)
-			return { distance, closest, normal };
-		else
-			return { distance, nullptr, normal };
-	}
-
 
-	std::tuple<double, RayTraceObject*, Vector<double, 3>> trace(Vector<double, 3> origin, Vector<double, 3> direction, std::vector<RayTraceObject*> scene)
-	{
-		std::vector<std::tuple<double, RayTraceObject*, Vector<double, 3>>> list;
-		for (auto e : scene)
+		// die ersten countX * countY samples liegen wie frueher auf dem raster, danach wird innerhalb der rasterzellen gejittert
+		if (sample < countX * countY)
 		{
-			auto elems = e->getDistance(origin, direction);
-			list.insert(list.end(), elems.begin(), elems.end());
+			x = 0;
+			y = 0;
 		}
-		return getClosestObject(list);
-	}
-
-	std::tuple<double, RayTraceObject*, Vector<double, 3>, Vector<double, 3>> tracePlus(Vector<double, 3> origin, Vector<double, 3> direction, std::vector<RayTraceObject*> scene)
-	{
-		auto [distance, object, normal] = trace(origin, direction, scene);
-		normal = normalize(normal);
-		Vector<double, 3> pos = origin + distance * direction;
-		pos = pos + normal * 0.000001; // delta wert um nicht das gleiche objekt am gleichen ort wieder zu treffen
-		return { distance, object, normal, pos };
+		// rasterzellen diagonal durchlaufen, damit auch ein pixel das adaptiv frueh aufhoert jede zeile und spalte getroffen hat
+		unsigned int k = sample % countX;
+		unsigned int l = (sample / countX + sample) % countY;
+		x = (k + x) / countX - 0.5;
+		y = (l + y) / countY - 0.5;
 	}
 
-	double dot(Vector<double, 3> v1, Vector<double, 3> v2)
-	{
-		return v1(0)* v2(0) + v1(1) * v2(1) + v1(2) * v2(2);
-	}
-
-	// funktioniert noch nicht richtig
-	Vector<double, 3> randomHemisphere(Vector<double, 3> normal)
-	{
-		const double pi = 3.141592653589793;
-		static std::uniform_real_distribution<double> random(0, 1.0);
-		static std::default_random_engine generator;
-
-		double angle1 = random(generator) * pi * 2;
-		double angle2 = random(generator) * pi;
-
-		normal = normalize(normal);
-
-		//Vector<double, 3> vec = { std::sin(angle1) * std::sin(angle2), std::cos(angle1) * std::sin(angle2), std::cos(angle2) };
-		//
-		//double angle = vec * normal;
-		//if (angle < 0)
-		//{
-		//	// funktioniert nicht
-		//	vec = vec - normal * angle * 2;
-		//}
-		//else
-
-		Vector<double, 3> rand = { 2 * (random(generator) - 0.5), 2 * (random(generator) - 0.5), 2 * (random(generator) - 0.5) };
-		Vector<double, 3> vec = normalize(normal + normalize(rand));
-
-		return vec;
-	}
-
-	Vector<unsigned char, 3> getColor(Vector<double, 3> origin, Vector<double, 3> dest, std::vector<RayTraceObject*> scene)
+	Vector<unsigned char, 3> getColor(Vector<double, 3> origin, Vector<double, 3> dest, const Scene& scene, unsigned int pixel)
 	{
 		Vector<double, 3> direction = normalize(dest - origin);
 
@@ -164,9 +55,9 @@ namespace path2
 
 			for (int i = 0; i < samples; i++)
 			{
-				Vector<double, 3> randomDir = randomHemisphere(normal1);
-				auto [distance2, object2, normal2, pos2] = tracePlus(pos1, randomDir, scene);
-				if (object2 == nullptr)
+				Random random(pixel, i);
+				Vector<double, 3> randomDir = randomHemisphere(normal1, random);
+				if (!occluded(pos1, randomDir, scene, std::numeric_limits<double>::max()))
 				{
 					lightStrength += 1.0;
 					lightIntensity += 1.0;
@@ -186,95 +77,8 @@ namespace path2
 		return color;
 	}
 
-	Vector<double, 3> tracePixel(Vector<double, 3> position, Vector<double, 3> normal, std::vector<RayTraceObject*> scene, unsigned int count, unsigned int countMax)
+	Bitmap<unsigned char> raytrace(unsigned int width, unsigned int height, unsigned int samples, double timeBudget, unsigned int minSamples, double noiseTarget)
 	{
-		if (count >= countMax)
-			return { 0.0, 0.0, 0.0 };
-
-		auto [distance, object, normalObject, posObject] = tracePlus(position, normal, scene);
-
-		if (object == nullptr)
-			return { 1.0, 1.0, 1.0 };
-		
-		Vector<double, 3> randomDir = randomHemisphere(normalObject);
-		Vector<double, 3> previousColor = tracePixel(posObject, randomDir, scene, count + 1, countMax);
-
-		Vector<double, 3> helpVector = cross(normal, normalObject);
-		Vector<double, 3> direction = normalize(cross(normalObject, helpVector));
-		
-		Vector<double, 3> mirroredNormal = -normal - direction * (-normal * direction) * 2;
-		Vector<double, 3> mirrored = tracePixel(posObject, mirroredNormal, scene, count + 1, countMax);
-		
-		Vector<double, 3> color = {
-			object->color(0) * previousColor(0) * (1.0 - object->transmission) + mirrored(0) * object->transmission,
-			object->color(1) * previousColor(1) * (1.0 - object->transmission) + mirrored(1) * object->transmission,
-			object->color(2) * previousColor(2) * (1.0 - object->transmission) + mirrored(2) * object->transmission
-		};
-		
-		return color;
-	}
-
-	Vector<double, 3> traceNormal(Vector<double, 3> position, Vector<double, 3> normal, std::vector<RayTraceObject*> scene)
-	{
-		auto [distance, object, normalObject, posObject] = tracePlus(position, normal, scene);
-
-		return normalObject;
-	}
-
-	double traceDistance(Vector<double, 3> position, Vector<double, 3> normal, std::vector<RayTraceObject*> scene)
-	{
-		auto [distance, object, normalObject, posObject] = tracePlus(position, normal, scene);
-
-		return distance;
-	}
-	
-	void run(unsigned int from, unsigned int to, Vector<double, 3> origin, Bitmap<unsigned char>* bitmap, Bitmap<unsigned char>* normalMap, Bitmap<unsigned char>* distanceMap, std::vector<RayTraceObject*> scene)
-	{
-		for (int i = from; i < to; i++)
-		{
-			for (int j = 0; j < 1000; j++)
-			{
-				Vector<double, 3> color = { 0, 0, 0 };
-				const int countX = 4;
-				const int countY = 4;
-
-				Vector<double, 3> normal;
-				double distance;
-
-				for (int k = 0; k < countX; k++)
-				{
-					for (int l = 0; l < countY; l++)
-					{
-						Vector<double, 3> dest = { -(i + ((double)k / (double)countX) - 0.5) / 1000.0 + 0.5, 2.7 - (j + ((double)l / (double)countY) - 0.5) / 1000.0 + 0.5, 0 };
-						color += tracePixel(origin, normalize(dest - origin), scene, 0, 4);
-						normal = traceNormal(origin, normalize(dest - origin), scene);
-						distance = traceDistance(origin, normalize(dest - origin), scene);
-					}
-				}
-
-				color *= 1.0 / (countX * countY);
-
-				(*bitmap)(i, j, 0) = std::min(color(0) * 255, 255.0);
-				(*bitmap)(i, j, 1) = std::min(color(1) * 255, 255.0);
-				(*bitmap)(i, j, 2) = std::min(color(2) * 255, 255.0);
-				(*normalMap)(i, j, 0) = (normal(0) + 1.0) * 128;
-				(*normalMap)(i, j, 1) = (normal(1) + 1.0) * 128;
-				(*normalMap)(i, j, 2) = (normal(2) + 1.0) * 128;
-				(*distanceMap)(i, j, 0) = distance * 8;
-				(*distanceMap)(i, j, 1) = distance * 8;
-				(*distanceMap)(i, j, 2) = distance * 8;
-
-			}
-		}
-	}
-
-	Bitmap<unsigned char> raytrace()
-	{
-		Bitmap<unsigned char> bitmap(1000, 1000, 3);
-		Bitmap<unsigned char> normalMap(1000, 1000, 3);
-		Bitmap<unsigned char> distanceMap(1000, 1000, 3);
-		bitmap.fill({ 0, 0, 0 });
-
 		TestPlane plane;
 		plane.color = { 1, 1, 1 };
 		plane.transmission = 0.0;
@@ -297,28 +101,43 @@ namespace path2
 		sphere3.pos = { 0.5, 0.5, 5 };
 		sphere3.transmission = 0.0;
 
-		std::vector<RayTraceObject*> scene;
-		scene.push_back(&plane);
-		scene.push_back(&sphere);
-		scene.push_back(&sphere2);
-		scene.push_back(&sphere3);
+		Scene scene;
+		scene.add(&plane);
+		scene.add(&sphere);
+		scene.add(&sphere2);
+		scene.add(&sphere3);
+		scene.build();
 
 		Vector<double, 3> origin = { 0, 3, -1 };
-		std::vector<std::thread> threads;
-		for (int i = 0; i < 8; i++)
-		{
-			threads.push_back(std::thread(run, i * 125, i * 125 + 125, origin, &bitmap, &normalMap, &distanceMap, scene));
-		}
-		for (int i = 0; i < 8; i++)
-		{
-			threads[i].join();
-		}
+		ProgressiveRenderer renderer(&scene, origin, width, height);
+		renderer.setAdaptive(minSamples, noiseTarget);
+		renderer.render(samples, timeBudget);
+		std::cout << renderer.getPassCount() << " passes, " << renderer.getSampleTotal() / (double)(width * height) << " samples per pixel, last pass:" << std::endl;
+		renderer.getScheduler().printStatistics(std::cout);
 
 		Denoiser denoiser(16, 0.01);
 
-		Bitmap<unsigned char> ret = denoiser.denoise(bitmap, normalMap, distanceMap);
+		Bitmap<unsigned char> bitmap = renderer.getSnapshot();
+		Bitmap<unsigned char> ret = denoiser.denoise(bitmap, renderer.getGBuffer());
 		return ret;
 	}
+
+	Bitmap<unsigned char> raytrace(const std::string& filename)
+	{
+		SceneFile file;
+		file.load(filename);
+		file.build();
+
+		ProgressiveRenderer renderer(&file.getScene(), file.origin, file.width, file.height);
+		renderer.render(file.samples);
+		std::cout << file.getScene().getObjectCount() << " objects, " << renderer.getPassCount() << " passes, last pass:" << std::endl;
+		renderer.getScheduler().printStatistics(std::cout);
+
+		Denoiser denoiser(16, 0.01);
+
+		Bitmap<unsigned char> bitmap = renderer.getSnapshot();
+		return denoiser.denoise(bitmap, renderer.getGBuffer());
+	}
 }
 
 int main3()
@@ -330,5 +149,13 @@ int main3()
 	//bitmap.saveAsPPM("test.ppm");
 	bitmap.saveAsBMP("pathtrace2.bmp");
 
+	return 0;
+}
+
+int main13()
+{
+	Bitmap<unsigned char> bitmap = path2::raytrace("scenes/spheres.scene");
+	bitmap.saveAsBMP("pathtrace_scene.bmp");
+
 	return 0;
 }
\ No newline at end of file
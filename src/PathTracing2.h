@@ -0,0 +1,1083 @@
+#pragma once
+
+#include "Matrix.h"
+#include "Bitmap.h"
+#include "BVH.h"
+#include "SphereArray.h"
+#include "TileScheduler.h"
+#include "Random.h"
+#include "PathGuiding.h"
+
+#include <vector>
+#include <tuple>
+#include <chrono>
+#include <atomic>
+#include <memory>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+
+namespace path2
+{
+	using namespace cg;
+
+	template <class T, unsigned int N>
+	Vector<T, N> normalize(Vector<T, N> vec)
+	{
+		return vec / (std::sqrt(vec * vec) + T(0.00001));
+	}
+
+	template <class T>
+	Vector<T, 3> cross(Vector<T, 3> v1, Vector<T, 3> v2)
+	{
+		return {
+			v1(1) * v2(2) - v1(2) * v2(1),
+			v1(2) * v2(0) - v1(0) * v2(2),
+			v1(0) * v2(1) - v1(1) * v2(0)
+		};
+	}
+
+	// versatz entlang der normalen nach einem treffer, float braucht wegen der kuerzeren mantisse einen groesseren
+	template <class T>
+	constexpr T getRayOffset()
+	{
+		return sizeof(T) < sizeof(double) ? T(0.0001) : T(0.000001);
+	}
+
+	// alle typen des path tracers sind ueber den skalartyp T parametrisiert, double ist die referenz und float der schnelle pfad
+	// die namen ohne Basic (Hit, Sphere, Scene, ...) sind die double varianten
+	template <class T>
+	class BasicRayTraceObject;
+
+	// naechster treffer eines strahls, wird von intersect nur ueberschrieben wenn ein naeherer treffer gefunden wurde
+	template <class T>
+	struct BasicHit
+	{
+		T distance;
+		BasicRayTraceObject<T>* object;
+		Vector<T, 3> normal;
+	};
+
+	template <class T>
+	class BasicRayTraceObject
+	{
+	public:
+		// sucht den naechsten treffer mit tmin < distanz < tmax, allokiert nichts
+		virtual bool intersect(Vector<T, 3> origin, Vector<T, 3> direction, T tmin, T tmax, BasicHit<T>& hit) { return false; };
+		// irgendein treffer mit tmin < distanz < tmax, objekte mit vielen primitiven hoeren beim ersten auf
+		virtual bool occluded(Vector<T, 3> origin, Vector<T, 3> direction, T tmin, T tmax) { BasicHit<T> hit; return intersect(origin, direction, tmin, tmax, hit); };
+		// unbeschraenkte objekte (z.b. die ebene) geben false zurueck und landen nicht in der BVH
+		virtual bool getBounds(AABB<T>& bounds) { return false; };
+		// lichtquellen: richtung von position auf das objekt aus zwei gleichverteilten zahlen, pdf im raumwinkel
+		// false, wenn das objekt so nicht abgetastet werden kann, es wird dann nur ueber BRDF strahlen getroffen
+		virtual bool sampleDirection(Vector<T, 3> position, T u1, T u2, Vector<T, 3>& direction, T& distance, T& pdf) { return false; };
+		// pdf von sampleDirection fuer eine richtung, die das objekt trifft
+		virtual T pdfDirection(Vector<T, 3> position, Vector<T, 3> direction) { return 0; };
+		Vector<T, 3> color;
+		T transmission;
+		// abgestrahlte leistung, standard schwarz
+		Vector<T, 3> emission;
+	};
+
+	template <class T>
+	class BasicTestPlane : public BasicRayTraceObject<T>
+	{
+	public:
+		bool intersect(Vector<T, 3> origin, Vector<T, 3> direction, T tmin, T tmax, BasicHit<T>& hit)
+		{
+			if (direction(1) == 0)
+				return false;
+			T distance = -(origin(1) / direction(1));
+			if (distance <= tmin || distance >= tmax)
+				return false;
+			hit = { distance, this, { T(0), T(1), T(0) } };
+			return true;
+		};
+		// kosinusgewichtet zur ebene hin, die ganze halbkugel unter bzw. ueber position ist ebene
+		bool sampleDirection(Vector<T, 3> position, T u1, T u2, Vector<T, 3>& direction, T& distance, T& pdf);
+		T pdfDirection(Vector<T, 3> position, Vector<T, 3> direction);
+	};
+
+	template <class T>
+	class BasicSphere : public BasicRayTraceObject<T>
+	{
+	public:
+		T size;
+		Vector<T, 3> pos;
+		bool intersect(Vector<T, 3> origin, Vector<T, 3> direction, T tmin, T tmax, BasicHit<T>& hit)
+		{
+			Vector<T, 3> offset = origin - pos;
+			T a = direction * direction;
+			T b = direction * offset;
+			T c = offset * offset - size * size;
+			T discriminant = b * b - a * c;
+			if (discriminant < 0)
+				return false;
+
+			T root = std::sqrt(discriminant);
+			T distance = (-b - root) / a;
+			if (distance <= tmin || distance >= tmax)
+			{
+				distance = (-b + root) / a;
+				if (distance <= tmin || distance >= tmax)
+					return false;
+			}
+			hit = { distance, this, offset + direction * distance };
+			return true;
+		};
+
+		bool getBounds(AABB<T>& bounds)
+		{
+			bounds = AABB<T>({ pos(0) - size, pos(1) - size, pos(2) - size }, { pos(0) + size, pos(1) + size, pos(2) + size });
+			return true;
+		};
+		// gleichverteilt im kegel, unter dem die kugel von position aus erscheint
+		bool sampleDirection(Vector<T, 3> position, T u1, T u2, Vector<T, 3>& direction, T& distance, T& pdf);
+		T pdfDirection(Vector<T, 3> position, Vector<T, 3> direction);
+	};
+
+	// szene mit BVH fuer die beschraenkten objekte, nach add() und nach dem verschieben von objekten muss build() aufgerufen werden
+	// kugeln bekommen eine eigene BVH ueber gepackte SoA daten, deren blaetter mit einem SIMD test geprueft werden
+	template <class T>
+	class BasicScene
+	{
+	public:
+		BasicScene();
+		void add(BasicRayTraceObject<T>* object);
+		void build();
+		bool trace(Vector<T, 3> origin, Vector<T, 3> direction, BasicHit<T>& hit) const;
+		// true sobald irgendein objekt zwischen 0 und tmax liegt, ohne normale und ohne den naechsten treffer zu suchen
+		bool occluded(Vector<T, 3> origin, Vector<T, 3> direction, T tmax) const;
+		unsigned int getObjectCount() const;
+		// box um alle beschraenkten objekte, die ebene zaehlt nicht dazu
+		AABB<T> getBounds() const;
+		// alle objekte mit emission, wird in build() gesammelt
+		const std::vector<BasicRayTraceObject<T>*>& getLights() const;
+		// ohne lichtabtastung bleibt getLights() leer und lichtquellen werden nur von zufaellig getroffen, gilt ab dem naechsten build()
+		void setLightSampling(bool enabled);
+	private:
+		std::vector<BasicRayTraceObject<T>*> objects;
+		std::vector<BasicRayTraceObject<T>*> unbounded;
+		std::vector<BasicSphere<T>*> spheres;
+		std::vector<BasicRayTraceObject<T>*> lights;
+		bool lightSampling;
+		BVH<T> bvh;
+		BVH<T> sphereBVH;
+		SphereArray<T> packedSpheres;
+	};
+
+	using Hit = BasicHit<double>;
+	using RayTraceObject = BasicRayTraceObject<double>;
+	using TestPlane = BasicTestPlane<double>;
+	using Sphere = BasicSphere<double>;
+	using Scene = BasicScene<double>;
+
+	template <class T>
+	bool trace(Vector<T, 3> origin, Vector<T, 3> direction, const std::vector<BasicRayTraceObject<T>*>& scene, BasicHit<T>& hit);
+	template <class T>
+	bool trace(Vector<T, 3> origin, Vector<T, 3> direction, const BasicScene<T>& scene, BasicHit<T>& hit);
+	// sichtbarkeit fuer AO- und schattenstrahlen: bricht beim ersten treffer mit 0 < distanz < tmax ab
+	template <class T>
+	bool occluded(Vector<T, 3> origin, Vector<T, 3> direction, const std::vector<BasicRayTraceObject<T>*>& scene, T tmax);
+	template <class T>
+	bool occluded(Vector<T, 3> origin, Vector<T, 3> direction, const BasicScene<T>& scene, T tmax);
+	// gibt distanz, objekt, normierte normale und den leicht nach aussen versetzten trefferpunkt zurueck, bei keinem treffer {-1, nullptr, {}, origin}
+	template <class T, class S>
+	std::tuple<T, BasicRayTraceObject<T>*, Vector<T, 3>, Vector<T, 3>> tracePlus(Vector<T, 3> origin, Vector<T, 3> direction, const S& scene);
+	template <class T>
+	T dot(Vector<T, 3> v1, Vector<T, 3> v2);
+	// tangente und bitangente zu einer normierten normalen, zusammen eine orthonormalbasis (Duff et al. 2017, ohne verzweigung)
+	template <class T>
+	void orthonormalBasis(Vector<T, 3> normal, Vector<T, 3>& tangent, Vector<T, 3>& bitangent);
+	// kosinusgewichtete richtung um die normierte normale aus zwei gleichverteilten zahlen, pdf = cos / pi
+	template <class T>
+	Vector<T, 3> cosineHemisphere(Vector<T, 3> normal, T u1, T u2);
+	template <class T>
+	T cosineHemispherePdf(Vector<T, 3> normal, Vector<T, 3> direction);
+	// kosinusgewichtet um normal, verbraucht zwei zufallszahlen
+	template <class T>
+	Vector<T, 3> randomHemisphere(Vector<T, 3> normal, Random& random);
+
+	// material der objekte: mit wahrscheinlichkeit transmission ein perfekter spiegel, sonst lambert mit color
+	// weight ist f * cos / pdf, also der faktor fuer den durchsatz, bei specular ist pdf ein dirac und wird als 0 gemeldet
+	template <class T>
+	struct BRDFSample
+	{
+		Vector<T, 3> direction;
+		Vector<T, 3> weight;
+		T pdf;
+		bool specular;
+	};
+
+	// incoming zeigt auf die oberflaeche zu, normal ist normiert und zeigt zur seite von incoming, verbraucht drei zufallszahlen
+	template <class T>
+	BRDFSample<T> sampleBRDF(const BasicRayTraceObject<T>& object, Vector<T, 3> incoming, Vector<T, 3> normal, Random& random);
+	// nur der diffuse anteil, der spiegel kann fuer eine vorgegebene richtung nie getroffen werden
+	template <class T>
+	Vector<T, 3> evalBRDF(const BasicRayTraceObject<T>& object, Vector<T, 3> normal, Vector<T, 3> direction);
+	template <class T>
+	T pdfBRDF(const BasicRayTraceObject<T>& object, Vector<T, 3> normal, Vector<T, 3> direction);
+	// anteil der gelernten verteilung an den diffusen richtungen, der rest bleibt kosinusgewichtet
+	template <class T>
+	constexpr T getGuidingFraction()
+	{
+		return T(0.5);
+	}
+	// pdf der diffusen richtungen, mit guide die mischung aus gelernter verteilung und kosinus, ohne guide wie pdfBRDF
+	template <class T>
+	T pdfGuided(const BasicRayTraceObject<T>& object, Vector<T, 3> normal, Vector<T, 3> direction, const BasicDirectionTree<T>* guide);
+	template <class T>
+	bool isEmissive(const BasicRayTraceObject<T>& object);
+
+	// schattenstrahl der direkten beleuchtung, radiance ist der beitrag ohne durchsatz und mit MIS gewicht, falls light von position aus sichtbar ist
+	template <class T>
+	struct LightSample
+	{
+		Vector<T, 3> direction;
+		// etwas vor der oberflaeche der lichtquelle, direkt als tmax fuer occluded verwendbar
+		T distance;
+		Vector<T, 3> radiance;
+		BasicRayTraceObject<T>* light;
+	};
+
+	// next event estimation: waehlt gleichverteilt eine lichtquelle und darauf eine richtung, verbraucht drei zufallszahlen wenn die szene lichter hat
+	// gewichtet mit der power heuristic gegen sampleBRDF (bzw. die mischung mit guide), false wenn kein beitrag moeglich ist
+	template <class T>
+	bool sampleLight(const BasicScene<T>& scene, const BasicRayTraceObject<T>& object, Vector<T, 3> position, Vector<T, 3> normal, Random& random, LightSample<T>& sample, const BasicDirectionTree<T>* guide = nullptr);
+	// MIS gewicht fuer die emission von light, die ein BRDF strahl von origin aus mit bsdfPdf trifft
+	template <class T>
+	T emissionWeight(const BasicScene<T>& scene, BasicRayTraceObject<T>* light, Vector<T, 3> origin, Vector<T, 3> direction, T bsdfPdf);
+	Vector<unsigned char, 3> getColor(Vector<double, 3> origin, Vector<double, 3> dest, const Scene& scene, unsigned int pixel);
+	// verfolgt einen einzigen pfad ohne rekursion, der himmel leuchtet weiss, emissive objekte werden an jedem treffer direkt abgetastet
+	// nach countMax treffern zaehlt nur noch, was bis dahin an licht gesammelt wurde
+	// firstNormal und firstDistance bekommen, falls gesetzt, normale und distanz des ersten treffers (bei keinem treffer {0, 0, 0} und -1)
+	// mit guide werden diffuse richtungen zur haelfte aus der gelernten verteilung gezogen, records bekommt fuer jeden diffusen abprall einen eintrag zum lernen
+	template <class T>
+	Vector<T, 3> tracePixel(Vector<T, 3> position, Vector<T, 3> normal, const BasicScene<T>& scene, unsigned int countMax, Random& random, Vector<T, 3>* firstNormal = nullptr, T* firstDistance = nullptr,
+		const BasicPathGuide<T>* guide = nullptr, std::vector<GuidingRecord<T>>* records = nullptr);
+	template <class T>
+	Vector<T, 3> getScreenPoint(T x, T y, unsigned int width, unsigned int height);
+	// versatz des primaerstrahls im pixel in [-0.5, 0.5), verbraucht die dimensionen 0 und 1
+	// Independent legt wie frueher die ersten 16 samples auf ein 4x4 raster und jittert danach in den rasterzellen, die anderen folgen werden direkt benutzt
+	void getPixelOffset(unsigned int sample, Random& random, SampleSequence sequence, double& x, double& y);
+
+	// progressiver renderer: jeder durchgang addiert ein sample pro pixel in einen float puffer, dazwischen gibt es jederzeit ein fertiges bild
+	// vorschau und endgueltiges bild laufen durch den gleichen code, nur mit anderem zeitbudget bzw. sampleziel
+	template <class T>
+	class BasicProgressiveRenderer
+	{
+	public:
+		using Clock = std::chrono::steady_clock;
+
+		BasicProgressiveRenderer(const BasicScene<T>* scene, Vector<T, 3> origin, unsigned int width, unsigned int height);
+
+		// adaptiv: nach minSamples bekommt ein pixel nur noch samples, solange das 95% konfidenzintervall seiner helligkeit breiter als +-noiseTarget ist
+		// noiseTarget = 0 schaltet das ab, dann bekommt jedes pixel in jedem durchgang ein sample
+		void setAdaptive(unsigned int minSamples, double noiseTarget);
+		// maximale pfadlaenge fuer tracePixel, standard 4
+		void setMaxDepth(unsigned int maxDepth);
+		// renderer mit verschiedenem seed benutzen unabhaengige zufallszahlen, standard 0
+		void setSeed(unsigned int seed);
+		// folge fuer pixelversatz und abprallrichtungen, standard Independent
+		void setSampler(SampleSequence sequence);
+		// path guiding: die ersten 2^trainingIterations - 1 durchgaenge lernen in iterationen von 1, 2, 4, ... durchgaengen die verteilung des einfallenden lichts,
+		// jede iteration tastet schon mit dem ergebnis der vorherigen ab, danach bleibt die verteilung fest, 0 schaltet guiding ab
+		// alle durchgaenge zaehlen zum bild, auch die ersten mit noch schlechter verteilung
+		void setGuiding(unsigned int trainingIterations);
+		const BasicPathGuide<T>* getGuide() const;
+		// rendert bis sampleTarget samples pro pixel erreicht, alle pixel konvergiert oder timeBudget sekunden vergangen sind (0 = ohne zeitlimit)
+		// gibt die anzahl fertiger durchgaenge zurueck, sampleTarget ist damit auch die obergrenze pro pixel
+		unsigned int render(unsigned int sampleTarget, double timeBudget = 0);
+		// hoechstens ein sample pro pixel, kacheln nach der deadline werden ausgelassen und der durchgang zaehlt dann nicht als fertig
+		bool renderPass(Clock::time_point deadline = Clock::time_point::max());
+		// mittelwert pro pixel linear auf 0..255 abgebildet und bei 1 abgeschnitten, nicht waehrend renderPass aufrufen
+		Bitmap<unsigned char> getSnapshot();
+		// normale (ebenen 0 bis 2) und distanz (ebene 3) des ersten treffers, wird im ersten sample jedes pixels geschrieben
+		Bitmap<float>& getGBuffer();
+		unsigned int getPassCount();
+		// summe aller samples ueber alle pixel bzw. nur im letzten durchgang
+		unsigned long long getSampleTotal();
+		unsigned long long getLastPassSamples();
+		TileScheduler& getScheduler();
+	private:
+		bool needsSample(unsigned int x, unsigned int y);
+		unsigned int renderTile(Tile tile);
+		void updateGuide();
+
+		const BasicScene<T>* scene;
+		Vector<T, 3> origin;
+		unsigned int width, height;
+		// summe der farben und anzahl samples pro pixel, die anzahl ist auch der sample index fuer den naechsten durchgang
+		Bitmap<float> accumulation;
+		Bitmap<unsigned int> sampleCount;
+		// laufender mittelwert und summe der quadrierten abweichungen der helligkeit (welford)
+		Bitmap<float> variance;
+		Bitmap<float> gBuffer;
+		unsigned int passCount;
+		unsigned int maxDepth;
+		unsigned int seed;
+		Sampler sampler;
+		unsigned int minSamples;
+		double noiseTarget;
+		unsigned long long sampleTotal;
+		unsigned long long lastPassSamples;
+		static constexpr unsigned int tileSize = 16;
+		TileScheduler scheduler;
+		std::unique_ptr<BasicPathGuide<T>> guide;
+		unsigned int trainingIterations;
+		unsigned int trainingPasses;
+		// eintraege des laufenden durchgangs pro kachel, damit sie unabhaengig von der threadreihenfolge eingetragen werden
+		std::vector<std::vector<GuidingRecord<T>>> guidingRecords;
+	};
+
+	using ProgressiveRenderer = BasicProgressiveRenderer<double>;
+
+	Bitmap<unsigned char> raytrace(unsigned int width = 1000, unsigned int height = 1000, unsigned int samples = 16, double timeBudget = 0, unsigned int minSamples = 0, double noiseTarget = 0);
+
+	// impl ---------------------------------
+
+	template<class T>
+	inline BasicScene<T>::BasicScene() : lightSampling(true), sphereBVH(SphereArray<T>::width)
+	{
+	}
+
+	template<class T>
+	inline void BasicScene<T>::add(BasicRayTraceObject<T>* object)
+	{
+		AABB<T> bounds;
+		if (BasicSphere<T>* sphere = dynamic_cast<BasicSphere<T>*>(object))
+			spheres.push_back(sphere);
+		else if (object->getBounds(bounds))
+			objects.push_back(object);
+		else
+			unbounded.push_back(object);
+	}
+
+	template<class T>
+	inline void BasicScene<T>::build()
+	{
+		std::vector<AABB<T>> bounds(objects.size());
+		for (unsigned int i = 0; i < objects.size(); i++)
+			objects[i]->getBounds(bounds[i]);
+		bvh.build(bounds);
+
+		// objekte in blattreihenfolge bringen, damit ein blatt direkt einen bereich von objects abdeckt
+		std::vector<BasicRayTraceObject<T>*> sorted(objects.size());
+		for (unsigned int i = 0; i < objects.size(); i++)
+			sorted[i] = objects[bvh.getIndices()[i]];
+		objects = sorted;
+
+		bounds.resize(spheres.size());
+		for (unsigned int i = 0; i < spheres.size(); i++)
+			spheres[i]->getBounds(bounds[i]);
+		sphereBVH.build(bounds);
+
+		std::vector<BasicSphere<T>*> sortedSpheres(spheres.size());
+		packedSpheres.clear();
+		for (unsigned int i = 0; i < spheres.size(); i++)
+		{
+			sortedSpheres[i] = spheres[sphereBVH.getIndices()[i]];
+			packedSpheres.add(sortedSpheres[i]->pos, sortedSpheres[i]->size);
+		}
+		spheres = sortedSpheres;
+
+		lights.clear();
+		if (!lightSampling)
+			return;
+		for (auto list : { &unbounded, &objects })
+			for (auto object : *list)
+				if (isEmissive(*object))
+					lights.push_back(object);
+		for (auto sphere : spheres)
+			if (isEmissive(*sphere))
+				lights.push_back(sphere);
+	}
+
+	template<class T>
+	inline bool BasicScene<T>::trace(Vector<T, 3> origin, Vector<T, 3> direction, BasicHit<T>& hit) const
+	{
+		T tmax = std::numeric_limits<T>::max();
+		bool found = false;
+
+		for (auto e : unbounded)
+		{
+			if (e->intersect(origin, direction, 0, tmax, hit))
+			{
+				tmax = hit.distance;
+				found = true;
+			}
+		}
+
+		if (bvh.intersect(origin, direction, tmax, [&](unsigned int first, unsigned int count, T& limit)
+		{
+			bool hitLeaf = false;
+			for (unsigned int i = first; i < first + count; i++)
+			{
+				if (objects[i]->intersect(origin, direction, 0, limit, hit))
+				{
+					limit = hit.distance;
+					hitLeaf = true;
+				}
+			}
+			return hitLeaf;
+		}))
+			found = true;
+
+		if (sphereBVH.intersect(origin, direction, tmax, [&](unsigned int first, unsigned int count, T& limit)
+		{
+			unsigned int index;
+			if (!packedSpheres.intersect(origin, direction, first, count, 0, limit, index))
+				return false;
+			hit = { limit, spheres[index], origin + direction * limit - spheres[index]->pos };
+			return true;
+		}))
+			found = true;
+
+		return found;
+	}
+
+	template<class T>
+	inline bool BasicScene<T>::occluded(Vector<T, 3> origin, Vector<T, 3> direction, T tmax) const
+	{
+		for (auto e : unbounded)
+			if (e->occluded(origin, direction, 0, tmax))
+				return true;
+
+		if (bvh.occluded(origin, direction, tmax, [&](unsigned int first, unsigned int count, T& limit)
+		{
+			for (unsigned int i = first; i < first + count; i++)
+				if (objects[i]->occluded(origin, direction, 0, limit))
+					return true;
+			return false;
+		}))
+			return true;
+
+		// ein SIMD test pro blatt, der naechste treffer darin kostet nicht mehr als irgendeiner
+		return sphereBVH.occluded(origin, direction, tmax, [&](unsigned int first, unsigned int count, T& limit)
+		{
+			unsigned int index;
+			return packedSpheres.intersect(origin, direction, first, count, 0, limit, index);
+		});
+	}
+
+	template<class T>
+	inline const std::vector<BasicRayTraceObject<T>*>& BasicScene<T>::getLights() const
+	{
+		return lights;
+	}
+
+	template<class T>
+	inline void BasicScene<T>::setLightSampling(bool enabled)
+	{
+		lightSampling = enabled;
+	}
+
+	template<class T>
+	inline AABB<T> BasicScene<T>::getBounds() const
+	{
+		AABB<T> bounds = bvh.getBounds();
+		bounds.extend(sphereBVH.getBounds());
+		return bounds;
+	}
+
+	template<class T>
+	inline unsigned int BasicScene<T>::getObjectCount() const
+	{
+		return objects.size() + unbounded.size() + spheres.size();
+	}
+
+	template<class T>
+	inline bool trace(Vector<T, 3> origin, Vector<T, 3> direction, const std::vector<BasicRayTraceObject<T>*>& scene, BasicHit<T>& hit)
+	{
+		T tmax = std::numeric_limits<T>::max();
+		bool found = false;
+		for (auto e : scene)
+		{
+			if (e->intersect(origin, direction, 0, tmax, hit))
+			{
+				tmax = hit.distance;
+				found = true;
+			}
+		}
+		return found;
+	}
+
+	template<class T>
+	inline bool trace(Vector<T, 3> origin, Vector<T, 3> direction, const BasicScene<T>& scene, BasicHit<T>& hit)
+	{
+		return scene.trace(origin, direction, hit);
+	}
+
+	template<class T>
+	inline bool occluded(Vector<T, 3> origin, Vector<T, 3> direction, const std::vector<BasicRayTraceObject<T>*>& scene, T tmax)
+	{
+		for (auto e : scene)
+			if (e->occluded(origin, direction, 0, tmax))
+				return true;
+		return false;
+	}
+
+	template<class T>
+	inline bool occluded(Vector<T, 3> origin, Vector<T, 3> direction, const BasicScene<T>& scene, T tmax)
+	{
+		return scene.occluded(origin, direction, tmax);
+	}
+
+	template<class T, class S>
+	inline std::tuple<T, BasicRayTraceObject<T>*, Vector<T, 3>, Vector<T, 3>> tracePlus(Vector<T, 3> origin, Vector<T, 3> direction, const S& scene)
+	{
+		BasicHit<T> hit;
+		if (!trace(origin, direction, scene, hit))
+			return { T(-1), nullptr, {}, origin };
+		Vector<T, 3> normal = normalize(hit.normal);
+		Vector<T, 3> pos = origin + direction * hit.distance;
+		pos = pos + normal * getRayOffset<T>(); // delta wert um nicht das gleiche objekt am gleichen ort wieder zu treffen
+		return { hit.distance, hit.object, normal, pos };
+	}
+
+	template<class T>
+	inline T dot(Vector<T, 3> v1, Vector<T, 3> v2)
+	{
+		return v1(0)* v2(0) + v1(1) * v2(1) + v1(2) * v2(2);
+	}
+
+	template<class T>
+	inline void orthonormalBasis(Vector<T, 3> normal, Vector<T, 3>& tangent, Vector<T, 3>& bitangent)
+	{
+		T sign = std::copysign(T(1), normal(2));
+		T a = T(-1) / (sign + normal(2));
+		T b = normal(0) * normal(1) * a;
+		tangent = { T(1) + sign * normal(0) * normal(0) * a, sign * b, -sign * normal(0) };
+		bitangent = { b, sign + normal(1) * normal(1) * a, -normal(1) };
+	}
+
+	template<class T>
+	inline Vector<T, 3> cosineHemisphere(Vector<T, 3> normal, T u1, T u2)
+	{
+		const T pi = T(3.141592653589793);
+
+		// gleichverteilt auf der kreisscheibe und auf die halbkugel hochprojiziert (Malley)
+		T radius = std::sqrt(u1);
+		T angle = T(2) * pi * u2;
+		T x = radius * std::cos(angle);
+		T y = radius * std::sin(angle);
+		T z = std::sqrt((std::max)(T(0), T(1) - u1));
+
+		Vector<T, 3> tangent, bitangent;
+		orthonormalBasis(normal, tangent, bitangent);
+		return tangent * x + bitangent * y + normal * z;
+	}
+
+	template<class T>
+	inline T cosineHemispherePdf(Vector<T, 3> normal, Vector<T, 3> direction)
+	{
+		const T pi = T(3.141592653589793);
+		return (std::max)(T(0), normal * direction) / pi;
+	}
+
+	template<class T>
+	inline Vector<T, 3> randomHemisphere(Vector<T, 3> normal, Random& random)
+	{
+		T u1 = T(random.next());
+		T u2 = T(random.next());
+		return cosineHemisphere(normalize(normal), u1, u2);
+	}
+
+	template<class T>
+	inline BRDFSample<T> sampleBRDF(const BasicRayTraceObject<T>& object, Vector<T, 3> incoming, Vector<T, 3> normal, Random& random)
+	{
+		// statt beide anteile zu verfolgen wird einer mit wahrscheinlichkeit transmission bzw. 1 - transmission gewaehlt, das gewicht kuerzt sich dabei weg
+		BRDFSample<T> sample;
+		if (random.next() < object.transmission)
+		{
+			Vector<T, 3> helpVector = cross(incoming, normal);
+			Vector<T, 3> direction = normalize(cross(normal, helpVector));
+			sample.direction = -incoming - direction * (-incoming * direction) * T(2);
+			sample.weight = { T(1), T(1), T(1) };
+			sample.pdf = T(0);
+			sample.specular = true;
+			// die zwei zahlen fuer die diffuse richtung werden trotzdem verbraucht, damit jeder pfad gleich viele dimensionen pro treffer hat
+			random.setDimension(random.getDimension() + 2);
+		}
+		else
+		{
+			// lambert: f = color / pi, pdf = cos / pi, also bleibt nur die farbe als gewicht
+			sample.direction = randomHemisphere(normal, random);
+			sample.weight = object.color;
+			sample.pdf = (T(1) - object.transmission) * cosineHemispherePdf(normal, sample.direction);
+			sample.specular = false;
+		}
+		return sample;
+	}
+
+	template<class T>
+	inline Vector<T, 3> evalBRDF(const BasicRayTraceObject<T>& object, Vector<T, 3> normal, Vector<T, 3> direction)
+	{
+		const T pi = T(3.141592653589793);
+		if (normal * direction <= 0)
+			return { T(0), T(0), T(0) };
+		Vector<T, 3> color = object.color;
+		return color * ((T(1) - object.transmission) / pi);
+	}
+
+	template<class T>
+	inline T pdfBRDF(const BasicRayTraceObject<T>& object, Vector<T, 3> normal, Vector<T, 3> direction)
+	{
+		return (T(1) - object.transmission) * cosineHemispherePdf(normal, direction);
+	}
+
+	template<class T>
+	inline T pdfGuided(const BasicRayTraceObject<T>& object, Vector<T, 3> normal, Vector<T, 3> direction, const BasicDirectionTree<T>* guide)
+	{
+		if (guide == nullptr)
+			return pdfBRDF(object, normal, direction);
+		if (normal * direction <= 0)
+			return T(0);
+		const T fraction = getGuidingFraction<T>();
+		return (T(1) - object.transmission) * (fraction * guide->pdf(direction) + (T(1) - fraction) * cosineHemispherePdf(normal, direction));
+	}
+
+	template<class T>
+	inline bool isEmissive(const BasicRayTraceObject<T>& object)
+	{
+		Vector<T, 3> emission = object.emission;
+		return emission(0) > 0 || emission(1) > 0 || emission(2) > 0;
+	}
+
+	template<class T>
+	inline bool BasicTestPlane<T>::sampleDirection(Vector<T, 3> position, T u1, T u2, Vector<T, 3>& direction, T& distance, T& pdf)
+	{
+		if (position(1) == 0)
+			return false;
+		Vector<T, 3> normal = { T(0), position(1) > 0 ? T(-1) : T(1), T(0) };
+		direction = cosineHemisphere(normal, u1, u2);
+		pdf = cosineHemispherePdf(normal, direction);
+		if (pdf <= 0)
+			return false;
+		distance = -position(1) / direction(1);
+		return true;
+	}
+
+	template<class T>
+	inline T BasicTestPlane<T>::pdfDirection(Vector<T, 3> position, Vector<T, 3> direction)
+	{
+		Vector<T, 3> normal = { T(0), position(1) > 0 ? T(-1) : T(1), T(0) };
+		return cosineHemispherePdf(normal, direction);
+	}
+
+	template<class T>
+	inline bool BasicSphere<T>::sampleDirection(Vector<T, 3> position, T u1, T u2, Vector<T, 3>& direction, T& distance, T& pdf)
+	{
+		const T pi = T(3.141592653589793);
+
+		Vector<T, 3> offset = pos - position;
+		T distanceSquared = offset * offset;
+		T radiusSquared = size * size;
+		if (distanceSquared <= radiusSquared)
+			return false;
+
+		// 1 - cos des oeffnungswinkels, so umgeformt dass es auch fuer kleine oder weit entfernte kugeln nicht ausloescht
+		T sinSquared = radiusSquared / distanceSquared;
+		T oneMinusCos = sinSquared / (T(1) + std::sqrt(T(1) - sinSquared));
+		T cosTheta = T(1) - u1 * oneMinusCos;
+		T sinTheta = std::sqrt((std::max)(T(0), T(1) - cosTheta * cosTheta));
+		T angle = T(2) * pi * u2;
+
+		T centerDistance = std::sqrt(distanceSquared);
+		Vector<T, 3> axis = offset * (T(1) / centerDistance);
+		Vector<T, 3> tangent, bitangent;
+		orthonormalBasis(axis, tangent, bitangent);
+		direction = tangent * (std::cos(angle) * sinTheta) + bitangent * (std::sin(angle) * sinTheta) + axis * cosTheta;
+		distance = centerDistance * cosTheta - std::sqrt((std::max)(T(0), radiusSquared - distanceSquared * sinTheta * sinTheta));
+		pdf = T(1) / (T(2) * pi * oneMinusCos);
+		return true;
+	}
+
+	template<class T>
+	inline T BasicSphere<T>::pdfDirection(Vector<T, 3> position, Vector<T, 3> direction)
+	{
+		const T pi = T(3.141592653589793);
+
+		Vector<T, 3> offset = pos - position;
+		T distanceSquared = offset * offset;
+		T radiusSquared = size * size;
+		if (distanceSquared <= radiusSquared)
+			return T(0);
+		T sinSquared = radiusSquared / distanceSquared;
+		T oneMinusCos = sinSquared / (T(1) + std::sqrt(T(1) - sinSquared));
+		return T(1) / (T(2) * pi * oneMinusCos);
+	}
+
+	template<class T>
+	inline bool sampleLight(const BasicScene<T>& scene, const BasicRayTraceObject<T>& object, Vector<T, 3> position, Vector<T, 3> normal, Random& random, LightSample<T>& sample, const BasicDirectionTree<T>* guide)
+	{
+		const std::vector<BasicRayTraceObject<T>*>& lights = scene.getLights();
+		if (lights.empty())
+			return false;
+		T select = T(random.next());
+		T u1 = T(random.next());
+		T u2 = T(random.next());
+
+		unsigned int index = (std::min)(static_cast<unsigned int>(select * lights.size()), static_cast<unsigned int>(lights.size() - 1));
+		BasicRayTraceObject<T>* light = lights[index];
+		// kugel und ebene koennen sich nicht selbst beleuchten
+		if (light == &object)
+			return false;
+		T pdf;
+		if (!light->sampleDirection(position, u1, u2, sample.direction, sample.distance, pdf) || pdf <= 0)
+			return false;
+		T cosine = normal * sample.direction;
+		if (cosine <= 0)
+			return false;
+
+		sample.distance *= T(1) - getRayOffset<T>();
+
+		T lightPdf = pdf / T(lights.size());
+		T bsdfPdf = pdfGuided(object, normal, sample.direction, guide);
+		T weight = lightPdf * lightPdf / (lightPdf * lightPdf + bsdfPdf * bsdfPdf);
+		Vector<T, 3> f = evalBRDF(object, normal, sample.direction);
+		T scale = cosine * weight / lightPdf;
+		sample.radiance = { f(0) * light->emission(0) * scale, f(1) * light->emission(1) * scale, f(2) * light->emission(2) * scale };
+		sample.light = light;
+		return true;
+	}
+
+	template<class T>
+	inline T emissionWeight(const BasicScene<T>& scene, BasicRayTraceObject<T>* light, Vector<T, 3> origin, Vector<T, 3> direction, T bsdfPdf)
+	{
+		if (scene.getLights().empty())
+			return T(1);
+		T lightPdf = light->pdfDirection(origin, direction) / T(scene.getLights().size());
+		return bsdfPdf * bsdfPdf / (bsdfPdf * bsdfPdf + lightPdf * lightPdf);
+	}
+
+	template<class T>
+	inline Vector<T, 3> tracePixel(Vector<T, 3> position, Vector<T, 3> normal, const BasicScene<T>& scene, unsigned int countMax, Random& random, Vector<T, 3>* firstNormal, T* firstDistance,
+		const BasicPathGuide<T>* guide, std::vector<GuidingRecord<T>>* records)
+	{
+		// ab dieser tiefe entscheidet russisches roulette ueber den abbruch
+		const unsigned int rouletteDepth = 2;
+
+		Vector<T, 3> radiance = { T(0), T(0), T(0) };
+		Vector<T, 3> throughput = { T(1), T(1), T(1) };
+		// pdf des letzten abpralls fuer das MIS gewicht, wenn er eine lichtquelle trifft, nach kamera und spiegel gilt die emission voll
+		T lastPdf = T(0);
+		bool lastSpecular = true;
+		// eintraege dieses pfads, ihr einfallendes licht steht erst am ende fest
+		size_t firstRecord = records != nullptr ? records->size() : 0;
+		for (unsigned int count = 0; count < countMax; count++)
+		{
+			auto [distance, object, normalObject, posObject] = tracePlus(position, normal, scene);
+
+			if (count == 0)
+			{
+				if (firstNormal != nullptr)
+					*firstNormal = normalObject;
+				if (firstDistance != nullptr)
+					*firstDistance = distance;
+			}
+
+			if (object == nullptr)
+			{
+				radiance += throughput;
+				break;
+			}
+
+			if (isEmissive(*object))
+			{
+				T weight = lastSpecular ? T(1) : emissionWeight(scene, object, position, normal, lastPdf);
+				radiance += Vector<T, 3>{ throughput(0) * object->emission(0), throughput(1) * object->emission(1), throughput(2) * object->emission(2) } * weight;
+			}
+
+			const BasicDirectionTree<T>* distribution = guide != nullptr ? guide->getDistribution(posObject) : nullptr;
+			LightSample<T> light;
+			if (sampleLight(scene, *object, posObject, normalObject, random, light, distribution))
+			{
+				if (!occluded(posObject, light.direction, scene, light.distance))
+					radiance += Vector<T, 3>{ throughput(0) * light.radiance(0), throughput(1) * light.radiance(1), throughput(2) * light.radiance(2) };
+			}
+
+			BRDFSample<T> sample = sampleBRDF(*object, normal, normalObject, random);
+			if (distribution != nullptr && !sample.specular)
+			{
+				// diffuser anteil als mischung: mit getGuidingFraction aus der gelernten verteilung, sonst bleibt die kosinusrichtung von sampleBRDF
+				const T fraction = getGuidingFraction<T>();
+				T guidePdf;
+				if (random.next() < fraction)
+				{
+					T u1 = T(random.next());
+					T u2 = T(random.next());
+					sample.direction = distribution->sample(u1, u2, guidePdf);
+				}
+				else
+				{
+					random.setDimension(random.getDimension() + 2);
+					guidePdf = distribution->pdf(sample.direction);
+				}
+				// wie pdfGuided, nur ohne die verteilung ein zweites mal abzusteigen, (1 - transmission) kuerzt sich im gewicht weg
+				T cosinePdf = cosineHemispherePdf(normalObject, sample.direction);
+				T mixture = normalObject * sample.direction > 0 ? fraction * guidePdf + (T(1) - fraction) * cosinePdf : T(0);
+				sample.pdf = (T(1) - object->transmission) * mixture;
+				sample.weight = mixture > 0 ? object->color * (cosinePdf / mixture) : Vector<T, 3>{ T(0), T(0), T(0) };
+			}
+			throughput = { throughput(0) * sample.weight(0), throughput(1) * sample.weight(1), throughput(2) * sample.weight(2) };
+			normal = sample.direction;
+			position = posObject;
+			lastPdf = sample.pdf;
+			lastSpecular = sample.specular;
+
+			if (count + 1 >= rouletteDepth)
+			{
+				T survival = (std::min)(T(0.95), (std::max)({ throughput(0), throughput(1), throughput(2) }));
+				if (random.next() >= survival)
+					break;
+				throughput *= T(1) / survival;
+			}
+
+			// die verteilung lernt das licht pro raumwinkel der diffusen richtungen, also ohne den anteil des spiegels
+			if (records != nullptr && !sample.specular && sample.pdf > 0)
+				records->push_back({ posObject, sample.direction, sample.pdf / (T(1) - object->transmission), throughput, radiance });
+		}
+
+		if (records != nullptr)
+		{
+			// einfallendes licht eines abpralls = alles was danach dazukam, geteilt durch den durchsatz bis dorthin
+			for (size_t i = firstRecord; i < records->size(); i++)
+			{
+				GuidingRecord<T>& record = (*records)[i];
+				for (unsigned int c = 0; c < 3; c++)
+					record.radiance(c) = record.throughput(c) > 0 ? (radiance(c) - record.radiance(c)) / record.throughput(c) : T(0);
+			}
+		}
+		return radiance;
+	}
+
+	template<class T>
+	inline Vector<T, 3> getScreenPoint(T x, T y, unsigned int width, unsigned int height)
+	{
+		// bei 1000x1000 wie bisher: ein bildschirm von 1x1 einheiten um (0, 2.7, 0)
+		return { T(-(x - width / 2.0) / height), T(2.7 - (y - height / 2.0) / height), T(0) };
+	}
+
+	template<class T>
+	inline BasicProgressiveRenderer<T>::BasicProgressiveRenderer(const BasicScene<T>* scene, Vector<T, 3> origin, unsigned int width, unsigned int height)
+		: scene(scene), origin(origin), width(width), height(height), accumulation(width, height, 3), sampleCount(width, height, 1), variance(width, height, 2), gBuffer(width, height, 4),
+		passCount(0), maxDepth(4), seed(0), sampler(SampleSequence::Independent, width, height), minSamples(0), noiseTarget(0), sampleTotal(0), lastPassSamples(0), scheduler(width, height, tileSize), trainingIterations(0), trainingPasses(0)
+	{
+		accumulation.fill({ 0, 0, 0 });
+		sampleCount.fill({ 0 });
+		variance.fill({ 0, 0 });
+	}
+
+	template<class T>
+	inline void BasicProgressiveRenderer<T>::setAdaptive(unsigned int minSamples, double noiseTarget)
+	{
+		this->minSamples = minSamples;
+		this->noiseTarget = noiseTarget;
+	}
+
+	template<class T>
+	inline void BasicProgressiveRenderer<T>::setMaxDepth(unsigned int maxDepth)
+	{
+		this->maxDepth = maxDepth;
+	}
+
+	template<class T>
+	inline void BasicProgressiveRenderer<T>::setSeed(unsigned int seed)
+	{
+		this->seed = seed;
+	}
+
+	template<class T>
+	inline void BasicProgressiveRenderer<T>::setGuiding(unsigned int trainingIterations)
+	{
+		this->trainingIterations = trainingIterations;
+		trainingPasses = 0;
+		guide.reset();
+		guidingRecords.clear();
+		if (trainingIterations == 0)
+			return;
+		guide = std::make_unique<BasicPathGuide<T>>(scene->getBounds());
+		guidingRecords.resize(((width + tileSize - 1) / tileSize) * ((height + tileSize - 1) / tileSize));
+	}
+
+	template<class T>
+	inline const BasicPathGuide<T>* BasicProgressiveRenderer<T>::getGuide() const
+	{
+		return guide.get();
+	}
+
+	template<class T>
+	inline void BasicProgressiveRenderer<T>::setSampler(SampleSequence sequence)
+	{
+		sampler = Sampler(sequence, width, height);
+	}
+
+	template<class T>
+	inline unsigned int BasicProgressiveRenderer<T>::render(unsigned int sampleTarget, double timeBudget)
+	{
+		Clock::time_point deadline = Clock::time_point::max();
+		if (timeBudget > 0)
+			deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(timeBudget));
+
+		while (passCount < sampleTarget && Clock::now() < deadline)
+		{
+			if (!renderPass(deadline) || lastPassSamples == 0)
+				break;
+		}
+		return passCount;
+	}
+
+	template<class T>
+	inline bool BasicProgressiveRenderer<T>::renderPass(Clock::time_point deadline)
+	{
+		std::atomic<bool> complete(true);
+		std::atomic<unsigned long long> samples(0);
+		scheduler.run([&](Tile tile)
+		{
+			if (Clock::now() >= deadline)
+			{
+				complete = false;
+				return;
+			}
+			samples += renderTile(tile);
+		});
+		lastPassSamples = samples;
+		sampleTotal += lastPassSamples;
+		if (complete)
+			passCount++;
+		if (guide != nullptr && guide->getIteration() < trainingIterations)
+			updateGuide();
+		return complete;
+	}
+
+	template<class T>
+	inline void BasicProgressiveRenderer<T>::updateGuide()
+	{
+		for (auto& records : guidingRecords)
+		{
+			for (const GuidingRecord<T>& record : records)
+				guide->record(record);
+			records.clear();
+		}
+		// iteration k dauert 2^k durchgaenge, danach tastet der naechste durchgang schon mit dem neuen stand ab
+		trainingPasses++;
+		if (trainingPasses >= (1u << guide->getIteration()))
+		{
+			guide->update();
+			trainingPasses = 0;
+		}
+	}
+
+	template<class T>
+	inline bool BasicProgressiveRenderer<T>::needsSample(unsigned int x, unsigned int y)
+	{
+		unsigned int count = sampleCount(x, y, 0);
+		if (noiseTarget <= 0 || count < (std::max)(minSamples, 2u))
+			return true;
+
+		// halbe breite des 95% konfidenzintervalls des mittelwerts
+		double error = 1.96 * std::sqrt(variance(x, y, 1) / ((count - 1.0) * count));
+		return error > noiseTarget;
+	}
+
+	template<class T>
+	inline unsigned int BasicProgressiveRenderer<T>::renderTile(Tile tile)
+	{
+		unsigned int samples = 0;
+		std::vector<GuidingRecord<T>>* records = nullptr;
+		if (guide != nullptr && guide->getIteration() < trainingIterations)
+			records = &guidingRecords[tile.y / tileSize * ((width + tileSize - 1) / tileSize) + tile.x / tileSize];
+
+		for (unsigned int i = tile.x; i < tile.x + tile.width; i++)
+		{
+			for (unsigned int j = tile.y; j < tile.y + tile.height; j++)
+			{
+				if (!needsSample(i, j))
+					continue;
+
+				// jedes pixel zaehlt seine samples selbst, ein abgebrochener durchgang hinterlaesst also keine luecken in der folge
+				unsigned int sample = sampleCount(i, j, 0);
+				Random random((seed * height + j) * width + i, sample, 0, &sampler);
+
+				double offsetX, offsetY;
+				getPixelOffset(sample, random, sampler.getSequence(), offsetX, offsetY);
+				Vector<T, 3> dest = getScreenPoint<T>(i + offsetX, j + offsetY, width, height);
+				Vector<T, 3> direction = normalize(dest - origin);
+				// der primaerstrahl liefert beim ersten sample auch normale und tiefe fuer den denoiser
+				Vector<T, 3> normal;
+				T distance;
+				Vector<T, 3> color = tracePixel(origin, direction, *scene, maxDepth, random, sample == 0 ? &normal : nullptr, sample == 0 ? &distance : nullptr, guide.get(), records);
+
+				accumulation(i, j, 0) += color(0);
+				accumulation(i, j, 1) += color(1);
+				accumulation(i, j, 2) += color(2);
+				sampleCount(i, j, 0) = sample + 1;
+				samples++;
+
+				double luminance = 0.2126 * color(0) + 0.7152 * color(1) + 0.0722 * color(2);
+				double delta = luminance - variance(i, j, 0);
+				variance(i, j, 0) += delta / (sample + 1);
+				variance(i, j, 1) += delta * (luminance - variance(i, j, 0));
+
+				if (sample == 0)
+				{
+					gBuffer(i, j, 0) = normal(0);
+					gBuffer(i, j, 1) = normal(1);
+					gBuffer(i, j, 2) = normal(2);
+					gBuffer(i, j, 3) = distance;
+				}
+			}
+		}
+		return samples;
+	}
+
+	template<class T>
+	inline Bitmap<unsigned char> BasicProgressiveRenderer<T>::getSnapshot()
+	{
+		Bitmap<unsigned char> bitmap(width, height, 3);
+		for (unsigned int i = 0; i < width; i++)
+		{
+			for (unsigned int j = 0; j < height; j++)
+			{
+				unsigned int count = sampleCount(i, j, 0);
+				for (unsigned int c = 0; c < 3; c++)
+				{
+					double value = count == 0 ? 0.0 : accumulation(i, j, c) / count;
+					bitmap(i, j, c) = std::min(value * 255, 255.0);
+				}
+			}
+		}
+		return bitmap;
+	}
+
+	template<class T>
+	inline Bitmap<float>& BasicProgressiveRenderer<T>::getGBuffer()
+	{
+		return gBuffer;
+	}
+
+	template<class T>
+	inline unsigned int BasicProgressiveRenderer<T>::getPassCount()
+	{
+		return passCount;
+	}
+
+	template<class T>
+	inline unsigned long long BasicProgressiveRenderer<T>::getSampleTotal()
+	{
+		return sampleTotal;
+	}
+
+	template<class T>
+	inline unsigned long long BasicProgressiveRenderer<T>::getLastPassSamples()
+	{
+		return lastPassSamples;
+	}
+
+	template<class T>
+	inline TileScheduler& BasicProgressiveRenderer<T>::getScheduler()
+	{
+		return scheduler;
+	}
+}
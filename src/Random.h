@@ -0,0 +1,77 @@
+#pragma once
+
+#include "Sampler.h"
+
+#include <cstdint>
+
+namespace cg
+{
+	// zaehlerbasierter zufallsgenerator: jede zahl ist ein hash aus (pixel, sample, dimension), es gibt keinen geteilten zustand
+	// damit ist ein bild unabhaengig von threadanzahl und kachelreihenfolge bitgenau reproduzierbar
+	// mit einem Sampler kommen die zahlen stattdessen aus dessen folge, ohne gelten unabhaengige hashwerte
+	class Random
+	{
+	public:
+		Random(unsigned int pixel, unsigned int sample, unsigned int dimension = 0, const Sampler* sampler = nullptr);
+
+		static uint64_t hash(uint64_t x);
+		static uint64_t getInteger(unsigned int pixel, unsigned int sample, unsigned int dimension);
+		// gleichverteilt in [0, 1)
+		static double get(unsigned int pixel, unsigned int sample, unsigned int dimension);
+
+		// naechste dimension dieses samples
+		double next();
+		unsigned int getDimension();
+		void setDimension(unsigned int dimension);
+	private:
+		unsigned int pixel;
+		unsigned int sample;
+		unsigned int dimension;
+		const Sampler* sampler;
+	};
+
+	// impl ---------------------------------
+
+	inline Random::Random(unsigned int pixel, unsigned int sample, unsigned int dimension, const Sampler* sampler) : pixel(pixel), sample(sample), dimension(dimension), sampler(sampler)
+	{
+	}
+
+	inline uint64_t Random::hash(uint64_t x)
+	{
+		// splitmix64 finalizer
+		x ^= x >> 30;
+		x *= 0xbf58476d1ce4e5b9ull;
+		x ^= x >> 27;
+		x *= 0x94d049bb133111ebull;
+		x ^= x >> 31;
+		return x;
+	}
+
+	inline uint64_t Random::getInteger(unsigned int pixel, unsigned int sample, unsigned int dimension)
+	{
+		uint64_t key = (static_cast<uint64_t>(pixel) << 32) | sample;
+		return hash(key ^ hash(dimension + 0x9e3779b97f4a7c15ull));
+	}
+
+	inline double Random::get(unsigned int pixel, unsigned int sample, unsigned int dimension)
+	{
+		return (getInteger(pixel, sample, dimension) >> 11) * (1.0 / 9007199254740992.0);
+	}
+
+	inline double Random::next()
+	{
+		if (sampler != nullptr)
+			return sampler->get(pixel, sample, dimension++);
+		return get(pixel, sample, dimension++);
+	}
+
+	inline unsigned int Random::getDimension()
+	{
+		return dimension;
+	}
+
+	inline void Random::setDimension(unsigned int dimension)
+	{
+		this->dimension = dimension;
+	}
+}
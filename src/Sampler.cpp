@@ -0,0 +1,247 @@
+#include "Sampler.h"
+#include "Random.h"
+
+#include <array>
+#include <cmath>
+#include <algorithm>
+
+namespace cg
+{
+	namespace
+	{
+		// primitive polynome (grad, koeffizienten ohne hoechsten und niedrigsten term) und startwerte m_i nach Joe und Kuo
+		// fuer die dimensionen 1 bis 15, dimension 0 ist die van der corput folge
+		struct SobolPolynomial
+		{
+			unsigned int degree;
+			uint32_t coefficients;
+			uint32_t initial[6];
+		};
+
+		const SobolPolynomial sobolPolynomials[Sampler::dimensionCount - 1] =
+		{
+			{ 1, 0, { 1 } },
+			{ 2, 1, { 1, 3 } },
+			{ 3, 1, { 1, 3, 1 } },
+			{ 3, 2, { 1, 1, 1 } },
+			{ 4, 1, { 1, 1, 3, 3 } },
+			{ 4, 4, { 1, 3, 5, 13 } },
+			{ 5, 2, { 1, 1, 5, 5, 17 } },
+			{ 5, 4, { 1, 1, 5, 5, 5 } },
+			{ 5, 7, { 1, 1, 7, 11, 19 } },
+			{ 5, 11, { 1, 1, 5, 1, 1 } },
+			{ 5, 13, { 1, 1, 1, 3, 11 } },
+			{ 5, 14, { 1, 3, 5, 5, 31 } },
+			{ 6, 1, { 1, 3, 3, 9, 7, 49 } },
+			{ 6, 13, { 1, 1, 1, 15, 21, 21 } },
+			{ 6, 16, { 1, 3, 1, 13, 27, 49 } }
+		};
+
+		using SobolDirections = std::array<std::array<uint32_t, 32>, Sampler::dimensionCount>;
+
+		SobolDirections buildDirections()
+		{
+			SobolDirections directions;
+			for (unsigned int i = 0; i < 32; i++)
+				directions[0][i] = 1u << (31 - i);
+
+			for (unsigned int d = 1; d < Sampler::dimensionCount; d++)
+			{
+				const SobolPolynomial& polynomial = sobolPolynomials[d - 1];
+				std::array<uint32_t, 32>& v = directions[d];
+				unsigned int s = polynomial.degree;
+				for (unsigned int i = 0; i < s; i++)
+					v[i] = polynomial.initial[i] << (31 - i);
+				for (unsigned int i = s; i < 32; i++)
+				{
+					v[i] = v[i - s] ^ (v[i - s] >> s);
+					for (unsigned int k = 1; k < s; k++)
+					{
+						if ((polynomial.coefficients >> (s - 1 - k)) & 1)
+							v[i] ^= v[i - k];
+					}
+				}
+			}
+			return directions;
+		}
+
+		// void and cluster (Ulichney 1993) auf einem torus: jedes pixel bekommt einen rang, benachbarte raenge liegen moeglichst weit auseinander
+		std::vector<float> buildBlueNoise()
+		{
+			const int size = Sampler::blueNoiseSize;
+			const int count = size * size;
+			const double sigma = 1.5;
+
+			std::vector<double> kernel(count);
+			for (int y = 0; y < size; y++)
+			{
+				for (int x = 0; x < size; x++)
+				{
+					int dx = (std::min)(x, size - x);
+					int dy = (std::min)(y, size - y);
+					kernel[y * size + x] = std::exp(-(dx * dx + dy * dy) / (2 * sigma * sigma));
+				}
+			}
+
+			std::vector<unsigned char> pattern(count, 0);
+			std::vector<double> energy(count, 0);
+			auto update = [&](int point, double sign)
+			{
+				int px = point % size;
+				int py = point / size;
+				for (int y = 0; y < size; y++)
+				{
+					const double* row = &kernel[((y - py + size) % size) * size];
+					for (int x = 0; x < size; x++)
+						energy[y * size + x] += sign * row[(x - px + size) % size];
+				}
+			};
+			auto tightestCluster = [&]()
+			{
+				int best = -1;
+				for (int i = 0; i < count; i++)
+					if (pattern[i] && (best < 0 || energy[i] > energy[best]))
+						best = i;
+				return best;
+			};
+			auto largestVoid = [&]()
+			{
+				int best = -1;
+				for (int i = 0; i < count; i++)
+					if (!pattern[i] && (best < 0 || energy[i] < energy[best]))
+						best = i;
+				return best;
+			};
+
+			// startmuster: zufaellige punkte, dann den dichtesten punkt so lange in die groesste luecke verschieben bis er dort bleibt
+			const int initial = count / 10;
+			for (int i = 0, placed = 0; placed < initial; i++)
+			{
+				int point = int(Random::getInteger(i, 0, 0) % count);
+				if (!pattern[point])
+				{
+					pattern[point] = 1;
+					update(point, 1);
+					placed++;
+				}
+			}
+			while (true)
+			{
+				int cluster = tightestCluster();
+				pattern[cluster] = 0;
+				update(cluster, -1);
+				int gap = largestVoid();
+				pattern[gap] = 1;
+				update(gap, 1);
+				if (gap == cluster)
+					break;
+			}
+
+			std::vector<int> rank(count);
+			std::vector<unsigned char> prototype = pattern;
+			std::vector<double> prototypeEnergy = energy;
+			// die punkte des startmusters bekommen absteigende raenge, indem immer der dichteste entfernt wird
+			for (int r = initial - 1; r >= 0; r--)
+			{
+				int cluster = tightestCluster();
+				pattern[cluster] = 0;
+				update(cluster, -1);
+				rank[cluster] = r;
+			}
+			// alle anderen aufsteigende raenge, indem immer die groesste luecke gefuellt wird
+			pattern = prototype;
+			energy = prototypeEnergy;
+			for (int r = initial; r < count; r++)
+			{
+				int gap = largestVoid();
+				pattern[gap] = 1;
+				update(gap, 1);
+				rank[gap] = r;
+			}
+
+			std::vector<float> noise(count);
+			for (int i = 0; i < count; i++)
+				noise[i] = (rank[i] + 0.5f) / count;
+			return noise;
+		}
+	}
+
+	Sampler::Sampler(SampleSequence sequence, unsigned int width, unsigned int height) : sequence(sequence), width((std::max)(width, 1u)), height((std::max)(height, 1u))
+	{
+		// tabellen einmal vorab bauen, nicht im ersten aufruf aus einem renderthread
+		sobol(0, 0);
+		if (sequence == SampleSequence::BlueNoise)
+			getBlueNoise();
+	}
+
+	double Sampler::get(unsigned int pixel, unsigned int sample, unsigned int dimension) const
+	{
+		if (sequence == SampleSequence::Independent || dimension >= dimensionCount)
+			return Random::get(pixel, sample, dimension);
+
+		const double scale = 1.0 / 4294967296.0;
+		if (sequence == SampleSequence::Sobol)
+		{
+			uint32_t index = owenScramble(sample, uint32_t(Random::hash(pixel)));
+			uint32_t value = owenScramble(sobol(index, dimension), uint32_t(Random::getInteger(pixel, 0, dimension)));
+			return value * scale;
+		}
+
+		// blue noise: gleiche folge fuer alle pixel eines bildes, pro dimension ein anderer ausschnitt der textur als verschiebung
+		unsigned int pixelCount = width * height;
+		unsigned int frame = pixel / pixelCount;
+		unsigned int x = pixel % pixelCount % width;
+		unsigned int y = pixel % pixelCount / width;
+		uint64_t seed = Random::getInteger(frame, 0, dimension);
+		uint32_t value = owenScramble(sobol(sample, dimension), uint32_t(seed));
+		unsigned int shiftX = static_cast<unsigned int>(seed >> 32) % blueNoiseSize;
+		unsigned int shiftY = static_cast<unsigned int>(seed >> 48) % blueNoiseSize;
+		const std::vector<float>& noise = getBlueNoise();
+		double result = value * scale + noise[((y + shiftY) % blueNoiseSize) * blueNoiseSize + (x + shiftX) % blueNoiseSize];
+		return result < 1.0 ? result : result - 1.0;
+	}
+
+	SampleSequence Sampler::getSequence() const
+	{
+		return sequence;
+	}
+
+	uint32_t Sampler::sobol(uint32_t index, unsigned int dimension)
+	{
+		static const SobolDirections directions = buildDirections();
+		const std::array<uint32_t, 32>& v = directions[dimension];
+		// ohne verzweigung, verwuerfelte indizes haben zufaellige hohe bits und wuerden jeden sprung falsch vorhersagen lassen
+		uint32_t result = 0;
+		for (unsigned int i = 0; i < 32; i++)
+			result ^= v[i] & (0u - ((index >> i) & 1u));
+		return result;
+	}
+
+	uint32_t Sampler::reverseBits(uint32_t value)
+	{
+		value = (value << 16) | (value >> 16);
+		value = ((value & 0x00ff00ff) << 8) | ((value & 0xff00ff00) >> 8);
+		value = ((value & 0x0f0f0f0f) << 4) | ((value & 0xf0f0f0f0) >> 4);
+		value = ((value & 0x33333333) << 2) | ((value & 0xcccccccc) >> 2);
+		value = ((value & 0x55555555) << 1) | ((value & 0xaaaaaaaa) >> 1);
+		return value;
+	}
+
+	uint32_t Sampler::owenScramble(uint32_t value, uint32_t seed)
+	{
+		// laine-karras permutation auf den gespiegelten bits, jedes bit haengt damit nur von den hoeherwertigen ab
+		value = reverseBits(value);
+		value += seed;
+		value ^= value * 0x6c50b47cu;
+		value ^= value * 0xb82f1e52u;
+		value ^= value * 0xc7afe638u;
+		value ^= value * 0x8d22f6e6u;
+		return reverseBits(value);
+	}
+
+	const std::vector<float>& Sampler::getBlueNoise()
+	{
+		static const std::vector<float> noise = buildBlueNoise();
+		return noise;
+	}
+}
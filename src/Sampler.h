@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace cg
+{
+	enum class SampleSequence
+	{
+		// unabhaengige hashwerte aus (pixel, sample, dimension), der renderer legt die ersten 16 samples zusaetzlich auf ein 4x4 raster
+		Independent,
+		// owen-verwuerfelte sobol folge, pro pixel eigene verwuerfelung und eigene reihenfolge der samples
+		Sobol,
+		// eine sobol folge fuer alle pixel, pro pixel und dimension um einen blue noise wert verschoben,
+		// der fehler bei wenigen samples verteilt sich dadurch als hochfrequentes rauschen ueber das bild
+		BlueNoise
+	};
+
+	// liefert die zahl fuer (pixel, sample, dimension) einer folge, zustandslos und damit von threads und kachelreihenfolge unabhaengig
+	// pixel ist der index j * width + i, weitere bilder (z.b. mit anderem seed) liegen mit hoeheren indizes dahinter
+	// ab dimensionCount dimensionen wird auf unabhaengige hashwerte zurueckgefallen
+	class Sampler
+	{
+	public:
+		static constexpr unsigned int dimensionCount = 16;
+		static constexpr unsigned int blueNoiseSize = 64;
+
+		Sampler(SampleSequence sequence = SampleSequence::Independent, unsigned int width = 1, unsigned int height = 1);
+
+		// gleichverteilt in [0, 1)
+		double get(unsigned int pixel, unsigned int sample, unsigned int dimension) const;
+		SampleSequence getSequence() const;
+
+		// unverwuerfelte sobol folge als 32 bit festkommazahl
+		static uint32_t sobol(uint32_t index, unsigned int dimension);
+		// verschachtelte gleichverteilte verwuerfelung nach Burley 2020, erhaelt die stratifizierung aller 2er potenzen
+		static uint32_t owenScramble(uint32_t value, uint32_t seed);
+	private:
+		static uint32_t reverseBits(uint32_t value);
+		static const std::vector<float>& getBlueNoise();
+
+		SampleSequence sequence;
+		unsigned int width, height;
+	};
+}
@@ -0,0 +1,313 @@
+#pragma once
+
+#include "PathTracing2.h"
+#include "TriangleMesh.h"
+#include "MeshFile.h"
+#include "Utils.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstring>
+#include <charconv>
+#include <stdexcept>
+#include <filesystem>
+
+namespace path2
+{
+	// szene als textdatei, eine anweisung pro zeile, # leitet einen kommentar ein:
+	//   resolution 1000 1000
+	//   samples 16
+	//   camera 0 3 -1                  (augpunkt)
+	//   material blau 0.8 0.8 1 0.4    (name, farbe, transmission)
+	//   plane weiss                    (ebene y = 0 mit material)
+	//   sphere blau 0.15 1 6.5 1       (material, mittelpunkt, radius)
+	//   mesh rot hase.obj              (material, OBJ/PLY/.cgmesh relativ zur szenendatei)
+	// die datei wird blockweise gelesen und an ort und stelle zerlegt, ohne einen std::string pro token wie bei cg::split
+	// die primitive landen direkt in zusammenhaengenden vektoren, build() haengt sie danach in die szene
+	// OBJ und PLY werden beim ersten laden einmal nach <datei>.cgmesh konvertiert, danach nur noch per mmap eingeblendet
+	template <class T>
+	class BasicSceneFile
+	{
+	public:
+		struct Material
+		{
+			Vector<T, 3> color;
+			T transmission;
+		};
+
+		BasicSceneFile();
+
+		// wirft std::runtime_error mit zeilennummer, wenn die datei nicht lesbar oder fehlerhaft ist
+		void load(const std::string& filename);
+		// wie load, fuer einen text im speicher
+		void parse(std::string_view text);
+		// einmal nach dem laden aufrufen, danach duerfen planes und spheres nicht mehr wachsen
+		void build();
+
+		BasicScene<T>& getScene();
+
+		unsigned int width, height;
+		unsigned int samples;
+		Vector<T, 3> origin;
+		std::vector<std::string> materialNames;
+		std::vector<Material> materials;
+		std::vector<BasicTestPlane<T>> planes;
+		std::vector<BasicSphere<T>> spheres;
+		std::vector<MappedMesh> meshFiles;
+		std::vector<Material> meshMaterials;
+	private:
+		void parseLine(const char* begin, const char* end);
+		std::string_view nextToken(const char*& begin, const char* end);
+		T nextNumber(const char*& begin, const char* end);
+		unsigned int nextInteger(const char*& begin, const char* end);
+		const Material& nextMaterial(const char*& begin, const char* end);
+		[[noreturn]] void error(const std::string& message);
+		MappedMesh openMesh(std::string_view name);
+
+		BasicScene<T> scene;
+		// netze brauchen stabile adressen fuer die szene, sie werden deshalb erst in build() erzeugt
+		std::vector<BasicTriangleMesh<T>> meshes;
+		std::filesystem::path directory;
+		unsigned int line;
+		// die meisten dateien benutzen ein material viele male hintereinander
+		unsigned int lastMaterial;
+	};
+
+	using SceneFile = BasicSceneFile<double>;
+
+	// rendert eine szenendatei mit aufloesung, samples und kamera aus der datei
+	Bitmap<unsigned char> raytrace(const std::string& filename);
+
+	// impl ---------------------------------
+
+	template<class T>
+	inline BasicSceneFile<T>::BasicSceneFile() : width(1000), height(1000), samples(16), line(0), lastMaterial(0)
+	{
+		origin = { T(0), T(3), T(-1) };
+	}
+
+	template<class T>
+	inline void BasicSceneFile<T>::load(const std::string& filename)
+	{
+		line = 0;
+		directory = std::filesystem::path(filename).parent_path();
+		readLines(filename, [&](const char* begin, const char* end)
+		{
+			line++;
+			parseLine(begin, end);
+		});
+	}
+
+	template<class T>
+	inline void BasicSceneFile<T>::parse(std::string_view text)
+	{
+		line = 0;
+		const char* begin = text.data();
+		const char* end = text.data() + text.size();
+		while (begin < end)
+		{
+			const char* newline = static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+			if (newline == nullptr)
+				newline = end;
+			line++;
+			parseLine(begin, newline);
+			begin = newline == end ? end : newline + 1;
+		}
+	}
+
+	template<class T>
+	inline void BasicSceneFile<T>::parseLine(const char* begin, const char* end)
+	{
+		const char* comment = static_cast<const char*>(std::memchr(begin, '#', end - begin));
+		if (comment != nullptr)
+			end = comment;
+
+		std::string_view keyword = nextToken(begin, end);
+		if (keyword.empty())
+			return;
+
+		if (keyword == "sphere")
+		{
+			const Material& material = nextMaterial(begin, end);
+			BasicSphere<T> sphere;
+			sphere.color = material.color;
+			sphere.transmission = material.transmission;
+			T x = nextNumber(begin, end);
+			T y = nextNumber(begin, end);
+			T z = nextNumber(begin, end);
+			sphere.pos = { x, y, z };
+			sphere.size = nextNumber(begin, end);
+			spheres.push_back(sphere);
+		}
+		else if (keyword == "plane")
+		{
+			const Material& material = nextMaterial(begin, end);
+			BasicTestPlane<T> plane;
+			plane.color = material.color;
+			plane.transmission = material.transmission;
+			planes.push_back(plane);
+		}
+		else if (keyword == "mesh")
+		{
+			const Material& material = nextMaterial(begin, end);
+			std::string_view name = nextToken(begin, end);
+			if (name.empty())
+				error("mesh without file");
+			meshFiles.push_back(openMesh(name));
+			meshMaterials.push_back(material);
+		}
+		else if (keyword == "material")
+		{
+			std::string_view name = nextToken(begin, end);
+			if (name.empty())
+				error("material without name");
+			Material material;
+			T r = nextNumber(begin, end);
+			T g = nextNumber(begin, end);
+			T b = nextNumber(begin, end);
+			material.color = { r, g, b };
+			material.transmission = nextNumber(begin, end);
+
+			// ein material mit gleichem namen wird ueberschrieben
+			unsigned int index = 0;
+			while (index < materialNames.size() && materialNames[index] != name)
+				index++;
+			if (index == materialNames.size())
+			{
+				materialNames.push_back(std::string(name));
+				materials.push_back(material);
+			}
+			else
+				materials[index] = material;
+		}
+		else if (keyword == "camera")
+		{
+			T x = nextNumber(begin, end);
+			T y = nextNumber(begin, end);
+			T z = nextNumber(begin, end);
+			origin = { x, y, z };
+		}
+		else if (keyword == "resolution")
+		{
+			width = nextInteger(begin, end);
+			height = nextInteger(begin, end);
+		}
+		else if (keyword == "samples")
+		{
+			samples = nextInteger(begin, end);
+		}
+		else
+			error("unknown keyword " + std::string(keyword));
+
+		if (!nextToken(begin, end).empty())
+			error("too many values");
+	}
+
+	template<class T>
+	inline std::string_view BasicSceneFile<T>::nextToken(const char*& begin, const char* end)
+	{
+		while (begin < end && (*begin == ' ' || *begin == '\t' || *begin == '\r'))
+			begin++;
+		const char* start = begin;
+		while (begin < end && *begin != ' ' && *begin != '\t' && *begin != '\r')
+			begin++;
+		return std::string_view(start, begin - start);
+	}
+
+	template<class T>
+	inline T BasicSceneFile<T>::nextNumber(const char*& begin, const char* end)
+	{
+		std::string_view token = nextToken(begin, end);
+		if (token.empty())
+			error("missing number");
+		double value;
+		auto [ptr, code] = std::from_chars(token.data(), token.data() + token.size(), value);
+		if (code != std::errc() || ptr != token.data() + token.size())
+			error("invalid number " + std::string(token));
+		return T(value);
+	}
+
+	template<class T>
+	inline unsigned int BasicSceneFile<T>::nextInteger(const char*& begin, const char* end)
+	{
+		std::string_view token = nextToken(begin, end);
+		if (token.empty())
+			error("missing integer");
+		unsigned int value;
+		auto [ptr, code] = std::from_chars(token.data(), token.data() + token.size(), value);
+		if (code != std::errc() || ptr != token.data() + token.size())
+			error("invalid integer " + std::string(token));
+		return value;
+	}
+
+	template<class T>
+	inline const typename BasicSceneFile<T>::Material& BasicSceneFile<T>::nextMaterial(const char*& begin, const char* end)
+	{
+		std::string_view name = nextToken(begin, end);
+		if (lastMaterial < materialNames.size() && materialNames[lastMaterial] == name)
+			return materials[lastMaterial];
+		for (unsigned int i = 0; i < materialNames.size(); i++)
+		{
+			if (materialNames[i] == name)
+			{
+				lastMaterial = i;
+				return materials[i];
+			}
+		}
+		error("unknown material " + std::string(name));
+	}
+
+	template<class T>
+	inline void BasicSceneFile<T>::error(const std::string& message)
+	{
+		throw std::runtime_error("Scene file line " + std::to_string(line) + ": " + message);
+	}
+
+	template<class T>
+	inline MappedMesh BasicSceneFile<T>::openMesh(std::string_view name)
+	{
+		std::filesystem::path path = directory / std::filesystem::path(name);
+		if (path.extension() == ".cgmesh")
+			return MappedMesh(path.string());
+
+		// die konvertierte datei wird neu erzeugt, wenn sie fehlt oder aelter als das original ist
+		std::filesystem::path converted = path;
+		converted += ".cgmesh";
+		try
+		{
+			if (!std::filesystem::exists(converted) || std::filesystem::last_write_time(converted) < std::filesystem::last_write_time(path))
+				convertMesh(path.string(), converted.string());
+			return MappedMesh(converted.string());
+		}
+		catch (const std::exception& e)
+		{
+			error(e.what());
+		}
+	}
+
+	template<class T>
+	inline void BasicSceneFile<T>::build()
+	{
+		for (auto& plane : planes)
+			scene.add(&plane);
+		for (auto& sphere : spheres)
+			scene.add(&sphere);
+		meshes.clear();
+		meshes.reserve(meshFiles.size());
+		for (unsigned int i = 0; i < meshFiles.size(); i++)
+		{
+			meshes.emplace_back(meshFiles[i]);
+			meshes.back().color = meshMaterials[i].color;
+			meshes.back().transmission = meshMaterials[i].transmission;
+			scene.add(&meshes.back());
+		}
+		scene.build();
+	}
+
+	template<class T>
+	inline BasicScene<T>& BasicSceneFile<T>::getScene()
+	{
+		return scene;
+	}
+}
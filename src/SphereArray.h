@@ -0,0 +1,228 @@
+#pragma once
+
+#include "Matrix.h"
+
+#include <vector>
+#include <cmath>
+
+#if defined(__AVX2__) && defined(__FMA__)
+	#include <immintrin.h>
+#endif
+
+namespace cg
+{
+	// kugeln als structure of arrays, damit der schnitttest 4 (double) bzw. 8 (float) kugeln pro AVX2 befehl pruefen kann
+	// die arrays sind um width - 1 elemente verlaengert, so dass ein voller vektor auch am ende gelesen werden darf
+	template <class T>
+	class SphereArray
+	{
+	public:
+		static constexpr unsigned int width = 32 / sizeof(T);
+
+		void add(Vector<T, 3> pos, T radius);
+		void clear();
+		unsigned int getSize() const;
+
+		// naechste wurzel mit tmin < t < tmax unter den kugeln [first, first + count), bei einem treffer werden tmax und index gesetzt
+		bool intersect(Vector<T, 3> origin, Vector<T, 3> direction, unsigned int first, unsigned int count, T tmin, T& tmax, unsigned int& index) const;
+		bool intersectScalar(Vector<T, 3> origin, Vector<T, 3> direction, unsigned int first, unsigned int count, T tmin, T& tmax, unsigned int& index) const;
+
+		std::vector<T> x, y, z, r;
+	private:
+		unsigned int size = 0;
+	};
+
+	// impl ---------------------------------
+
+	template<class T>
+	inline void SphereArray<T>::add(Vector<T, 3> pos, T radius)
+	{
+		x.resize(size + width);
+		y.resize(size + width);
+		z.resize(size + width);
+		r.resize(size + width);
+		x[size] = pos(0);
+		y[size] = pos(1);
+		z[size] = pos(2);
+		r[size] = radius;
+		size++;
+	}
+
+	template<class T>
+	inline void SphereArray<T>::clear()
+	{
+		x.clear();
+		y.clear();
+		z.clear();
+		r.clear();
+		size = 0;
+	}
+
+	template<class T>
+	inline unsigned int SphereArray<T>::getSize() const
+	{
+		return size;
+	}
+
+	template<class T>
+	inline bool SphereArray<T>::intersectScalar(Vector<T, 3> origin, Vector<T, 3> direction, unsigned int first, unsigned int count, T tmin, T& tmax, unsigned int& index) const
+	{
+		T a = direction * direction;
+		T inverseA = T(1) / a;
+		bool hit = false;
+		for (unsigned int i = first; i < first + count; i++)
+		{
+			T ox = origin(0) - x[i];
+			T oy = origin(1) - y[i];
+			T oz = origin(2) - z[i];
+			T b = direction(0) * ox + direction(1) * oy + direction(2) * oz;
+			T c = ox * ox + oy * oy + oz * oz - r[i] * r[i];
+			T discriminant = b * b - a * c;
+			if (discriminant < 0)
+				continue;
+
+			T root = std::sqrt(discriminant);
+			T t = (-b - root) * inverseA;
+			if (t <= tmin)
+				t = (-b + root) * inverseA;
+			if (t > tmin && t < tmax)
+			{
+				tmax = t;
+				index = i;
+				hit = true;
+			}
+		}
+		return hit;
+	}
+
+#if defined(__AVX2__) && defined(__FMA__)
+	template<>
+	inline bool SphereArray<double>::intersect(Vector<double, 3> origin, Vector<double, 3> direction, unsigned int first, unsigned int count, double tmin, double& tmax, unsigned int& index) const
+	{
+		double a = direction * direction;
+		__m256d ox = _mm256_set1_pd(origin(0));
+		__m256d oy = _mm256_set1_pd(origin(1));
+		__m256d oz = _mm256_set1_pd(origin(2));
+		__m256d dx = _mm256_set1_pd(direction(0));
+		__m256d dy = _mm256_set1_pd(direction(1));
+		__m256d dz = _mm256_set1_pd(direction(2));
+		__m256d av = _mm256_set1_pd(a);
+		__m256d inverseA = _mm256_set1_pd(1.0 / a);
+		__m256d tminv = _mm256_set1_pd(tmin);
+		__m256d tmaxv = _mm256_set1_pd(tmax);
+		__m256d zero = _mm256_setzero_pd();
+		__m256d lanes = _mm256_set_pd(3, 2, 1, 0);
+		__m256d end = _mm256_set1_pd(first + count);
+
+		bool hit = false;
+		for (unsigned int i = first; i < first + count; i += width)
+		{
+			__m256d cx = _mm256_sub_pd(ox, _mm256_loadu_pd(&x[i]));
+			__m256d cy = _mm256_sub_pd(oy, _mm256_loadu_pd(&y[i]));
+			__m256d cz = _mm256_sub_pd(oz, _mm256_loadu_pd(&z[i]));
+			__m256d radius = _mm256_loadu_pd(&r[i]);
+
+			__m256d b = _mm256_fmadd_pd(dz, cz, _mm256_fmadd_pd(dy, cy, _mm256_mul_pd(dx, cx)));
+			__m256d c = _mm256_fmsub_pd(cz, cz, _mm256_fmsub_pd(radius, radius, _mm256_fmadd_pd(cy, cy, _mm256_mul_pd(cx, cx))));
+			__m256d discriminant = _mm256_fmsub_pd(b, b, _mm256_mul_pd(av, c));
+			__m256d root = _mm256_sqrt_pd(_mm256_max_pd(discriminant, zero));
+
+			__m256d nb = _mm256_sub_pd(zero, b);
+			__m256d t0 = _mm256_mul_pd(_mm256_sub_pd(nb, root), inverseA);
+			__m256d t1 = _mm256_mul_pd(_mm256_add_pd(nb, root), inverseA);
+			__m256d t = _mm256_blendv_pd(t0, t1, _mm256_cmp_pd(t0, tminv, _CMP_LE_OQ));
+
+			__m256d valid = _mm256_cmp_pd(discriminant, zero, _CMP_GE_OQ);
+			valid = _mm256_and_pd(valid, _mm256_cmp_pd(t, tminv, _CMP_GT_OQ));
+			valid = _mm256_and_pd(valid, _mm256_cmp_pd(t, tmaxv, _CMP_LT_OQ));
+			valid = _mm256_and_pd(valid, _mm256_cmp_pd(_mm256_add_pd(_mm256_set1_pd(i), lanes), end, _CMP_LT_OQ));
+
+			int mask = _mm256_movemask_pd(valid);
+			if (mask == 0)
+				continue;
+
+			alignas(32) double distances[4];
+			_mm256_store_pd(distances, t);
+			for (unsigned int lane = 0; lane < 4; lane++)
+			{
+				if ((mask & (1 << lane)) && distances[lane] < tmax)
+				{
+					tmax = distances[lane];
+					index = i + lane;
+					hit = true;
+				}
+			}
+			tmaxv = _mm256_set1_pd(tmax);
+		}
+		return hit;
+	}
+
+	template<>
+	inline bool SphereArray<float>::intersect(Vector<float, 3> origin, Vector<float, 3> direction, unsigned int first, unsigned int count, float tmin, float& tmax, unsigned int& index) const
+	{
+		float a = direction * direction;
+		__m256 ox = _mm256_set1_ps(origin(0));
+		__m256 oy = _mm256_set1_ps(origin(1));
+		__m256 oz = _mm256_set1_ps(origin(2));
+		__m256 dx = _mm256_set1_ps(direction(0));
+		__m256 dy = _mm256_set1_ps(direction(1));
+		__m256 dz = _mm256_set1_ps(direction(2));
+		__m256 av = _mm256_set1_ps(a);
+		__m256 inverseA = _mm256_set1_ps(1.0f / a);
+		__m256 tminv = _mm256_set1_ps(tmin);
+		__m256 tmaxv = _mm256_set1_ps(tmax);
+		__m256 zero = _mm256_setzero_ps();
+		__m256i lanes = _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+		__m256i end = _mm256_set1_epi32(first + count);
+
+		bool hit = false;
+		for (unsigned int i = first; i < first + count; i += width)
+		{
+			__m256 cx = _mm256_sub_ps(ox, _mm256_loadu_ps(&x[i]));
+			__m256 cy = _mm256_sub_ps(oy, _mm256_loadu_ps(&y[i]));
+			__m256 cz = _mm256_sub_ps(oz, _mm256_loadu_ps(&z[i]));
+			__m256 radius = _mm256_loadu_ps(&r[i]);
+
+			__m256 b = _mm256_fmadd_ps(dz, cz, _mm256_fmadd_ps(dy, cy, _mm256_mul_ps(dx, cx)));
+			__m256 c = _mm256_fmsub_ps(cz, cz, _mm256_fmsub_ps(radius, radius, _mm256_fmadd_ps(cy, cy, _mm256_mul_ps(cx, cx))));
+			__m256 discriminant = _mm256_fmsub_ps(b, b, _mm256_mul_ps(av, c));
+			__m256 root = _mm256_sqrt_ps(_mm256_max_ps(discriminant, zero));
+
+			__m256 nb = _mm256_sub_ps(zero, b);
+			__m256 t0 = _mm256_mul_ps(_mm256_sub_ps(nb, root), inverseA);
+			__m256 t1 = _mm256_mul_ps(_mm256_add_ps(nb, root), inverseA);
+			__m256 t = _mm256_blendv_ps(t0, t1, _mm256_cmp_ps(t0, tminv, _CMP_LE_OQ));
+
+			__m256 valid = _mm256_cmp_ps(discriminant, zero, _CMP_GE_OQ);
+			valid = _mm256_and_ps(valid, _mm256_cmp_ps(t, tminv, _CMP_GT_OQ));
+			valid = _mm256_and_ps(valid, _mm256_cmp_ps(t, tmaxv, _CMP_LT_OQ));
+			__m256i inside = _mm256_cmpgt_epi32(end, _mm256_add_epi32(_mm256_set1_epi32(i), lanes));
+			valid = _mm256_and_ps(valid, _mm256_castsi256_ps(inside));
+
+			int mask = _mm256_movemask_ps(valid);
+			if (mask == 0)
+				continue;
+
+			alignas(32) float distances[8];
+			_mm256_store_ps(distances, t);
+			for (unsigned int lane = 0; lane < 8; lane++)
+			{
+				if ((mask & (1 << lane)) && distances[lane] < tmax)
+				{
+					tmax = distances[lane];
+					index = i + lane;
+					hit = true;
+				}
+			}
+			tmaxv = _mm256_set1_ps(tmax);
+		}
+		return hit;
+	}
+#endif
+
+	template<class T>
+	inline bool SphereArray<T>::intersect(Vector<T, 3> origin, Vector<T, 3> direction, unsigned int first, unsigned int count, T tmin, T& tmax, unsigned int& index) const
+	{
+		return intersectScalar(origin, direction, first, count, tmin, tmax, index);
+	}
+}
@@ -0,0 +1,561 @@
+#include "TileNetwork.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "Ws2_32.lib")
+#else
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+#include <stdexcept>
+#include <cerrno>
+#include <iomanip>
+#include <algorithm>
+#include <cstring>
+
+namespace cg
+{
+	namespace
+	{
+#ifdef _WIN32
+		using Socket = SOCKET;
+		const Socket invalidSocket = INVALID_SOCKET;
+#else
+		using Socket = int;
+		const Socket invalidSocket = -1;
+#endif
+
+#ifdef MSG_NOSIGNAL
+		// ein toter worker darf den coordinator nicht mit SIGPIPE beenden
+		const int sendFlags = MSG_NOSIGNAL;
+#else
+		const int sendFlags = 0;
+#endif
+
+		// alle nachrichten beginnen mit diesem kopf, ein ergebnis hat danach width * height * layerCount bytes
+		// die zahlen werden in der byte-reihenfolge des rechners geschickt, alle rechner im pool sind x86
+		enum class MessageType : std::uint32_t
+		{
+			Hello = 0x43474831,
+			Job,
+			Result,
+			Quit
+		};
+
+		const std::uint32_t protocolVersion = 1;
+
+		struct Message
+		{
+			MessageType type;
+			std::uint32_t id;
+			std::uint32_t frame;
+			std::uint32_t x, y, width, height;
+			std::uint32_t frameWidth, frameHeight, layerCount;
+		};
+
+		Socket toSocket(std::intptr_t socket)
+		{
+			return static_cast<Socket>(socket);
+		}
+
+		void startSockets()
+		{
+#ifdef _WIN32
+			// winsock muss einmal pro prozess gestartet werden
+			static bool started = []()
+			{
+				WSADATA data;
+				return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+			}();
+			if (!started)
+				throw std::runtime_error("WSAStartup failed");
+#endif
+		}
+
+		void closeSocket(Socket socket)
+		{
+#ifdef _WIN32
+			closesocket(socket);
+#else
+			close(socket);
+#endif
+		}
+
+		void setSocketOptions(Socket socket, double receiveTimeout)
+		{
+			int noDelay = 1;
+			setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+#ifdef _WIN32
+			DWORD milliseconds = static_cast<DWORD>(receiveTimeout * 1000.0);
+			setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&milliseconds), sizeof(milliseconds));
+#else
+			timeval time;
+			time.tv_sec = static_cast<long>(receiveTimeout);
+			time.tv_usec = static_cast<long>((receiveTimeout - time.tv_sec) * 1e6);
+			setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, &time, sizeof(time));
+#ifdef SO_NOSIGPIPE
+			int noSignal = 1;
+			setsockopt(socket, SOL_SOCKET, SO_NOSIGPIPE, &noSignal, sizeof(noSignal));
+#endif
+#endif
+		}
+
+		bool sendAll(Socket socket, const void* data, size_t size)
+		{
+			const char* bytes = static_cast<const char*>(data);
+			while (size > 0)
+			{
+				int sent = send(socket, bytes, static_cast<int>((std::min)(size, size_t(1 << 20))), sendFlags);
+				if (sent <= 0)
+					return false;
+				bytes += sent;
+				size -= sent;
+			}
+			return true;
+		}
+
+		// der coordinator wartet nie auf einen einzelnen worker, halbe nachrichten bleiben im puffer der verbindung
+		void setNonBlocking(Socket socket)
+		{
+#ifdef _WIN32
+			u_long mode = 1;
+			ioctlsocket(socket, FIONBIO, &mode);
+#else
+			fcntl(socket, F_SETFL, fcntl(socket, F_GETFL, 0) | O_NONBLOCK);
+#endif
+		}
+
+		bool wouldBlock()
+		{
+#ifdef _WIN32
+			return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+			return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+		}
+
+		// haengt an, was gerade da ist, ohne zu warten; false wenn die verbindung abgebrochen ist
+		bool receiveAvailable(Socket socket, std::vector<unsigned char>& buffer)
+		{
+			const size_t chunk = 1 << 16;
+			size_t used = buffer.size();
+			buffer.resize(used + chunk);
+			int received = recv(socket, reinterpret_cast<char*>(buffer.data() + used), static_cast<int>(chunk), 0);
+			buffer.resize(used + (std::max)(received, 0));
+			return received > 0 || (received < 0 && wouldBlock());
+		}
+
+		// false bei abbruch der verbindung oder wenn laenger als der receive timeout nichts kommt
+		bool receiveAll(Socket socket, void* data, size_t size)
+		{
+			char* bytes = static_cast<char*>(data);
+			while (size > 0)
+			{
+				int received = recv(socket, bytes, static_cast<int>((std::min)(size, size_t(1 << 20))), 0);
+				if (received <= 0)
+					return false;
+				bytes += received;
+				size -= received;
+			}
+			return true;
+		}
+	}
+
+	TileCoordinator::TileCoordinator(unsigned int width, unsigned int height, unsigned int layerCount, unsigned int tileSize, unsigned short port, const std::string& address)
+		: width(width), height(height), layerCount(layerCount), tileSize((std::max)(tileSize, 1u)), pipelineDepth(2), slowFactor(4), minimumSlowTime(1), timeout(30), connectTimeout(60),
+		finishedFrames(0), tileTime(0), tileTimeCount(0), totalTime(0)
+	{
+		startSockets();
+		Socket socket = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+		if (socket == invalidSocket)
+			throw std::runtime_error("TileCoordinator could not create a socket");
+		int reuse = 1;
+		setsockopt(socket, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+
+		sockaddr_in local = {};
+		local.sin_family = AF_INET;
+		local.sin_port = htons(port);
+		if (inet_pton(AF_INET, address.c_str(), &local.sin_addr) != 1 || bind(socket, reinterpret_cast<sockaddr*>(&local), sizeof(local)) != 0 || listen(socket, 64) != 0)
+		{
+			closeSocket(socket);
+			throw std::runtime_error("TileCoordinator could not listen on " + address + ":" + std::to_string(port));
+		}
+
+		socklen_t length = sizeof(local);
+		getsockname(socket, reinterpret_cast<sockaddr*>(&local), &length);
+		this->port = ntohs(local.sin_port);
+		listener = static_cast<std::intptr_t>(socket);
+	}
+
+	TileCoordinator::~TileCoordinator()
+	{
+		for (auto& connection : connections)
+			closeSocket(toSocket(connection.socket));
+		closeSocket(toSocket(listener));
+	}
+
+	unsigned short TileCoordinator::getPort()
+	{
+		return port;
+	}
+
+	void TileCoordinator::setPipelineDepth(unsigned int depth)
+	{
+		pipelineDepth = (std::max)(depth, 1u);
+	}
+
+	void TileCoordinator::setTimeouts(double slowFactor, double minimumSlowTime, double timeout, double connectTimeout)
+	{
+		this->slowFactor = slowFactor;
+		this->minimumSlowTime = minimumSlowTime;
+		this->timeout = timeout;
+		this->connectTimeout = connectTimeout;
+	}
+
+	void TileCoordinator::accept()
+	{
+		Socket socket = ::accept(toSocket(listener), nullptr, nullptr);
+		if (socket == invalidSocket)
+			return;
+		setSocketOptions(socket, timeout);
+		setNonBlocking(socket);
+
+		// worker wird die verbindung erst mit dem Hello kopf, siehe receive
+		Connection connection;
+		connection.socket = static_cast<std::intptr_t>(socket);
+		connection.worker = 0;
+		connection.greeted = false;
+		connection.closed = false;
+		connection.headStart = connection.lastMessage = Clock::now();
+		connections.push_back(std::move(connection));
+	}
+
+	bool TileCoordinator::assign(Connection& connection, Clock::time_point now)
+	{
+		while (connection.jobs.size() < pipelineDepth)
+		{
+			unsigned int index = static_cast<unsigned int>(jobs.size());
+			while (!pending.empty() && index == jobs.size())
+			{
+				if (!jobs[pending.front()].done)
+					index = pending.front();
+				pending.pop_front();
+			}
+
+			// nichts mehr offen: kacheln von langsamen workern kopieren, die am laengsten haengende zuerst
+			if (index == jobs.size())
+			{
+				double slowTime = (std::max)(minimumSlowTime, tileTimeCount > 0 ? slowFactor * tileTime / tileTimeCount : 0.0);
+				double longest = slowTime;
+				for (auto& other : connections)
+				{
+					if (&other == &connection || other.jobs.empty())
+						continue;
+					double running = std::chrono::duration<double>(now - other.headStart).count();
+					if (running <= longest)
+						continue;
+					for (unsigned int candidate : other.jobs)
+					{
+						if (!jobs[candidate].done && jobs[candidate].copies < 2 && std::find(connection.jobs.begin(), connection.jobs.end(), candidate) == connection.jobs.end())
+						{
+							index = candidate;
+							longest = running;
+							break;
+						}
+					}
+				}
+				if (index == jobs.size())
+					return true;
+			}
+
+			if (jobs[index].copies > 0)
+				statistics[connection.worker].backups++;
+			const TileJob& job = jobs[index].job;
+			Message message = { MessageType::Job, index, job.frame, job.tile.x, job.tile.y, job.tile.width, job.tile.height, width, height, layerCount };
+			// auftraege sind klein und pro worker hoechstens pipelineDepth unterwegs, ein voller sendepuffer heisst der worker liest nicht mehr
+			if (!sendAll(toSocket(connection.socket), &message, sizeof(message)))
+				return false;
+			if (connection.jobs.empty())
+				connection.headStart = now;
+			connection.jobs.push_back(index);
+			jobs[index].copies++;
+		}
+		return true;
+	}
+
+	bool TileCoordinator::receive(Connection& connection, std::function<void(unsigned int, Bitmap<unsigned char>&)>& finished)
+	{
+		if (!receiveAvailable(toSocket(connection.socket), connection.buffer))
+			return false;
+
+		// alle vollstaendigen nachrichten abarbeiten, der rest wartet auf den naechsten aufruf
+		size_t offset = 0;
+		while (connection.buffer.size() - offset >= sizeof(Message))
+		{
+			Message message;
+			std::memcpy(&message, connection.buffer.data() + offset, sizeof(message));
+
+			// andere programme auf dem port werden am kopf erkannt und wieder getrennt
+			if (!connection.greeted)
+			{
+				if (message.type != MessageType::Hello || message.id != protocolVersion)
+					return false;
+				connection.greeted = true;
+				connection.worker = static_cast<unsigned int>(statistics.size());
+				connection.headStart = connection.lastMessage = Clock::now();
+				statistics.push_back({ 0, 0, 0, 0, 0, true });
+				offset += sizeof(message);
+				continue;
+			}
+
+			if (message.type != MessageType::Result || message.id >= jobs.size())
+				return false;
+			auto position = std::find(connection.jobs.begin(), connection.jobs.end(), message.id);
+			Tile tile = jobs[message.id].job.tile;
+			if (position == connection.jobs.end() || message.x != tile.x || message.y != tile.y || message.width != tile.width || message.height != tile.height || message.layerCount != layerCount)
+				return false;
+			size_t length = sizeof(message) + size_t(tile.width) * tile.height * layerCount;
+			if (connection.buffer.size() - offset < length)
+				break;
+			connection.jobs.erase(position);
+			complete(connection, message.id, connection.buffer.data() + offset + sizeof(message), finished);
+			offset += length;
+		}
+		connection.buffer.erase(connection.buffer.begin(), connection.buffer.begin() + offset);
+		return true;
+	}
+
+	void TileCoordinator::complete(Connection& connection, unsigned int id, const unsigned char* pixels, std::function<void(unsigned int, Bitmap<unsigned char>&)>& finished)
+	{
+		auto now = Clock::now();
+		double busy = std::chrono::duration<double>(now - connection.headStart).count();
+		connection.headStart = connection.lastMessage = now;
+		jobs[id].copies--;
+		WorkerStatistics& worker = statistics[connection.worker];
+		worker.busy += busy;
+
+		Job& job = jobs[id];
+		if (job.done)
+		{
+			worker.duplicates++;
+			return;
+		}
+		job.done = true;
+		worker.tiles++;
+		tileTime += busy;
+		tileTimeCount++;
+
+		Tile tile = job.job.tile;
+		unsigned int frame = job.job.frame;
+		auto bitmap = frames.find(frame);
+		if (bitmap == frames.end())
+			bitmap = frames.emplace(frame, Bitmap<unsigned char>(width, height, layerCount)).first;
+		for (unsigned int j = tile.y; j < tile.y + tile.height; j++)
+			for (unsigned int i = tile.x; i < tile.x + tile.width; i++)
+				for (unsigned int k = 0; k < layerCount; k++)
+					bitmap->second(i, j, k) = *pixels++;
+
+		if (--remaining[frame] == 0)
+		{
+			finished(frame, bitmap->second);
+			frames.erase(bitmap);
+			finishedFrames++;
+		}
+	}
+
+	void TileCoordinator::drop(Connection& connection)
+	{
+		closeSocket(toSocket(connection.socket));
+		connection.closed = true;
+		if (!connection.greeted)
+			return;
+		WorkerStatistics& worker = statistics[connection.worker];
+		worker.alive = false;
+		// in der alten reihenfolge vorne einreihen, kacheln mit einer kopie bei einem anderen worker bleiben dort
+		for (auto job = connection.jobs.rbegin(); job != connection.jobs.rend(); job++)
+		{
+			jobs[*job].copies--;
+			if (!jobs[*job].done)
+			{
+				worker.lost++;
+				if (jobs[*job].copies == 0)
+					pending.push_front(*job);
+			}
+		}
+		connection.jobs.clear();
+	}
+
+	void TileCoordinator::run(unsigned int frameCount, std::function<void(unsigned int, Bitmap<unsigned char>&)> finished)
+	{
+		jobs.clear();
+		pending.clear();
+		frames.clear();
+		for (unsigned int frame = 0; frame < frameCount; frame++)
+		{
+			for (unsigned int y = 0; y < height; y += tileSize)
+			{
+				for (unsigned int x = 0; x < width; x += tileSize)
+				{
+					pending.push_back(static_cast<unsigned int>(jobs.size()));
+					jobs.push_back({ { frame, { x, y, (std::min)(tileSize, width - x), (std::min)(tileSize, height - y) } }, 0, false });
+				}
+			}
+		}
+		remaining.assign(frameCount, static_cast<unsigned int>(jobs.size() / (std::max)(frameCount, 1u)));
+		finishedFrames = 0;
+		tileTime = 0;
+		tileTimeCount = 0;
+
+		auto start = Clock::now();
+		auto lastWorker = start;
+		while (finishedFrames < frameCount)
+		{
+			auto now = Clock::now();
+			for (auto& connection : connections)
+			{
+				// auch ein worker, der mitten in einer nachricht haengen bleibt, gilt nach timeout als tot
+				bool silent = (!connection.greeted || !connection.jobs.empty()) && std::chrono::duration<double>(now - connection.lastMessage).count() > timeout;
+				if (silent || (connection.greeted && !assign(connection, now)))
+					drop(connection);
+			}
+			connections.erase(std::remove_if(connections.begin(), connections.end(), [](const Connection& connection) { return connection.closed; }), connections.end());
+
+			if (!connections.empty())
+				lastWorker = now;
+			else if (std::chrono::duration<double>(now - lastWorker).count() > connectTimeout)
+				throw std::runtime_error("TileCoordinator has no workers left");
+
+			// kurzes intervall, damit langsame worker auch ohne neue nachrichten bemerkt werden
+			fd_set readable;
+			FD_ZERO(&readable);
+			FD_SET(toSocket(listener), &readable);
+			Socket highest = toSocket(listener);
+			for (auto& connection : connections)
+			{
+				FD_SET(toSocket(connection.socket), &readable);
+				highest = (std::max)(highest, toSocket(connection.socket));
+			}
+			timeval wait = { 0, 50000 };
+			if (select(static_cast<int>(highest + 1), &readable, nullptr, nullptr, &wait) <= 0)
+				continue;
+
+			for (auto& connection : connections)
+			{
+				if (FD_ISSET(toSocket(connection.socket), &readable) && !receive(connection, finished))
+					drop(connection);
+			}
+			connections.erase(std::remove_if(connections.begin(), connections.end(), [](const Connection& connection) { return connection.closed; }), connections.end());
+			if (FD_ISSET(toSocket(listener), &readable))
+				accept();
+		}
+		totalTime = std::chrono::duration<double>(Clock::now() - start).count();
+
+		// die worker beenden sich selbst, kacheln die noch unterwegs sind werden verworfen
+		Message quit{};
+		quit.type = MessageType::Quit;
+		for (auto& connection : connections)
+		{
+			sendAll(toSocket(connection.socket), &quit, sizeof(quit));
+			closeSocket(toSocket(connection.socket));
+		}
+		connections.clear();
+	}
+
+	std::vector<WorkerStatistics> TileCoordinator::getStatistics()
+	{
+		return statistics;
+	}
+
+	void TileCoordinator::printStatistics(std::ostream& stream)
+	{
+		stream << "total " << std::fixed << std::setprecision(1) << totalTime * 1000.0 << " ms with " << statistics.size() << " workers" << std::endl;
+		for (unsigned int i = 0; i < statistics.size(); i++)
+		{
+			stream << "worker " << std::setw(3) << i
+				<< "  busy " << std::setw(9) << statistics[i].busy * 1000.0 << " ms"
+				<< "  tiles " << std::setw(6) << statistics[i].tiles
+				<< "  backups " << std::setw(4) << statistics[i].backups
+				<< "  duplicates " << std::setw(4) << statistics[i].duplicates
+				<< "  lost " << std::setw(4) << statistics[i].lost
+				<< (statistics[i].alive ? "" : "  (dead)") << std::endl;
+		}
+	}
+
+	TileWorker::TileWorker(std::function<void(TileJob, Bitmap<unsigned char>&)> render) : render(render), tileCount(0)
+	{
+	}
+
+	bool TileWorker::run(const std::string& host, unsigned short port)
+	{
+		startSockets();
+		addrinfo hints = {};
+		hints.ai_family = AF_INET;
+		hints.ai_socktype = SOCK_STREAM;
+		addrinfo* address = nullptr;
+		if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &address) != 0)
+			return false;
+		Socket socket = ::socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+		bool connected = socket != invalidSocket && connect(socket, address->ai_addr, static_cast<int>(address->ai_addrlen)) == 0;
+		freeaddrinfo(address);
+		if (!connected)
+		{
+			if (socket != invalidSocket)
+				closeSocket(socket);
+			return false;
+		}
+		// der worker wartet beliebig lange auf die naechste kachel
+		setSocketOptions(socket, 0);
+
+		Message message{};
+		message.type = MessageType::Hello;
+		message.id = protocolVersion;
+		bool finished = false;
+		std::vector<unsigned char> pixels;
+		bool open = sendAll(socket, &message, sizeof(message));
+		while (open && receiveAll(socket, &message, sizeof(message)))
+		{
+			if (message.type == MessageType::Quit)
+			{
+				finished = true;
+				break;
+			}
+			if (message.type != MessageType::Job)
+				break;
+
+			auto [bitmapWidth, bitmapHeight] = bitmap.getSize();
+			if (bitmapWidth != message.frameWidth || bitmapHeight != message.frameHeight || bitmap.getLayerCount() != message.layerCount)
+				bitmap = Bitmap<unsigned char>(message.frameWidth, message.frameHeight, message.layerCount);
+			Tile tile = { message.x, message.y, message.width, message.height };
+			render({ message.frame, tile }, bitmap);
+			tileCount++;
+
+			pixels.resize(size_t(tile.width) * tile.height * message.layerCount);
+			unsigned char* destination = pixels.data();
+			for (unsigned int j = tile.y; j < tile.y + tile.height; j++)
+				for (unsigned int i = tile.x; i < tile.x + tile.width; i++)
+					for (unsigned int k = 0; k < message.layerCount; k++)
+						*destination++ = bitmap(i, j, k);
+
+			message.type = MessageType::Result;
+			open = sendAll(socket, &message, sizeof(message)) && sendAll(socket, pixels.data(), pixels.size());
+		}
+		closeSocket(socket);
+		return finished;
+	}
+
+	unsigned int TileWorker::getTileCount()
+	{
+		return tileCount;
+	}
+}
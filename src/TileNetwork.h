@@ -0,0 +1,123 @@
+#pragma once
+
+#include "TileScheduler.h"
+#include "Bitmap.h"
+
+#include <vector>
+#include <deque>
+#include <map>
+#include <string>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+
+namespace cg
+{
+	// eine kachel aus einer bildfolge
+	struct TileJob
+	{
+		unsigned int frame;
+		Tile tile;
+	};
+
+	struct WorkerStatistics
+	{
+		double busy;
+		unsigned int tiles;
+		// kopien von kacheln, die bei einem langsamen worker hingen
+		unsigned int backups;
+		// ergebnisse fuer kacheln, die schon ein anderer worker geliefert hat
+		unsigned int duplicates;
+		// kacheln, die beim tod des workers noch offen waren und neu verteilt wurden
+		unsigned int lost;
+		bool alive;
+	};
+
+	// verteilt die kacheln einer bildfolge ueber tcp an worker prozesse und setzt die ergebnisse zu Bitmaps zusammen
+	// jeder worker hat bis zu pipelineDepth kacheln gleichzeitig, damit er zwischen zwei kacheln nicht auf das netz wartet
+	// bricht die verbindung ab oder kommt timeout sekunden lang nichts, gilt der worker als tot und seine kacheln kommen vorne in die warteschlange
+	// laeuft die kachel eines workers laenger als slowFactor mal die mittlere kachelzeit, bekommt ein freier worker eine kopie, das erste ergebnis gewinnt
+	class TileCoordinator
+	{
+	public:
+		// port 0 nimmt einen freien port, siehe getPort, mit address "0.0.0.0" koennen sich auch andere rechner verbinden
+		TileCoordinator(unsigned int width, unsigned int height, unsigned int layerCount = 3, unsigned int tileSize = 32, unsigned short port = 0, const std::string& address = "127.0.0.1");
+		~TileCoordinator();
+
+		unsigned short getPort();
+		void setPipelineDepth(unsigned int depth);
+		// minimumSlowTime verhindert kopien, solange noch keine kachelzeit gemessen ist, connectTimeout gilt, solange kein worker verbunden ist
+		void setTimeouts(double slowFactor, double minimumSlowTime, double timeout, double connectTimeout);
+		// rendert frameCount bilder, finished bekommt jedes bild, sobald alle seine kacheln da sind
+		void run(unsigned int frameCount, std::function<void(unsigned int, Bitmap<unsigned char>&)> finished);
+		std::vector<WorkerStatistics> getStatistics();
+		void printStatistics(std::ostream& stream);
+	private:
+		using Clock = std::chrono::steady_clock;
+
+		struct Job
+		{
+			TileJob job;
+			// wie viele worker die kachel gerade haben
+			unsigned int copies;
+			bool done;
+		};
+
+		struct Connection
+		{
+			std::intptr_t socket;
+			// index in statistics, erst gueltig wenn greeted
+			unsigned int worker;
+			bool greeted;
+			bool closed;
+			// empfangene bytes, die noch keine ganze nachricht ergeben
+			std::vector<unsigned char> buffer;
+			// gesendete kacheln in der reihenfolge, in der der worker sie abarbeitet, die vorderste laeuft seit headStart
+			std::deque<unsigned int> jobs;
+			Clock::time_point headStart;
+			Clock::time_point lastMessage;
+		};
+
+		void accept();
+		bool assign(Connection& connection, Clock::time_point now);
+		bool receive(Connection& connection, std::function<void(unsigned int, Bitmap<unsigned char>&)>& finished);
+		void complete(Connection& connection, unsigned int id, const unsigned char* pixels, std::function<void(unsigned int, Bitmap<unsigned char>&)>& finished);
+		void drop(Connection& connection);
+
+		unsigned int width, height;
+		unsigned int layerCount;
+		unsigned int tileSize;
+		unsigned int pipelineDepth;
+		double slowFactor, minimumSlowTime, timeout, connectTimeout;
+		std::intptr_t listener;
+		unsigned short port;
+
+		std::vector<Job> jobs;
+		std::deque<unsigned int> pending;
+		std::vector<Connection> connections;
+		std::map<unsigned int, Bitmap<unsigned char>> frames;
+		std::vector<unsigned int> remaining;
+		unsigned int finishedFrames;
+		double tileTime;
+		unsigned int tileTimeCount;
+		std::vector<WorkerStatistics> statistics;
+		double totalTime;
+	};
+
+	// verbindet sich mit einem TileCoordinator und rendert kacheln, bis der coordinator fertig ist
+	class TileWorker
+	{
+	public:
+		// render schreibt die kachel in ein bild in voller groesse, zurueckgeschickt wird nur der bereich der kachel
+		TileWorker(std::function<void(TileJob, Bitmap<unsigned char>&)> render);
+
+		// false, wenn keine verbindung zustande kam oder sie vor dem ende abbrach
+		bool run(const std::string& host, unsigned short port);
+		unsigned int getTileCount();
+	private:
+		std::function<void(TileJob, Bitmap<unsigned char>&)> render;
+		Bitmap<unsigned char> bitmap;
+		unsigned int tileCount;
+	};
+}
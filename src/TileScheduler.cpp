@@ -0,0 +1,123 @@
+#include "TileScheduler.h"
+
+#include <thread>
+#include <chrono>
+#include <iomanip>
+#include <algorithm>
+
+namespace cg
+{
+	TileScheduler::TileScheduler(unsigned int width, unsigned int height, unsigned int tileSize, unsigned int threadCount) : width(width), height(height), tileSize((std::max)(tileSize, 1u)), threadCount(threadCount), totalTime(0)
+	{
+		if (this->threadCount == 0)
+			this->threadCount = (std::max)(std::thread::hardware_concurrency(), 1u);
+		queues = std::vector<Queue>(this->threadCount);
+	}
+
+	bool TileScheduler::next(unsigned int thread, Tile& tile, bool& stolen)
+	{
+		{
+			std::lock_guard<std::mutex> lock(queues[thread].mutex);
+			if (!queues[thread].tiles.empty())
+			{
+				tile = queues[thread].tiles.front();
+				queues[thread].tiles.pop_front();
+				stolen = false;
+				return true;
+			}
+		}
+
+		// eigene warteschlange leer, bei den nachbarn von hinten stehlen
+		for (unsigned int i = 1; i < threadCount; i++)
+		{
+			Queue& victim = queues[(thread + i) % threadCount];
+			std::lock_guard<std::mutex> lock(victim.mutex);
+			if (!victim.tiles.empty())
+			{
+				tile = victim.tiles.back();
+				victim.tiles.pop_back();
+				stolen = true;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void TileScheduler::work(unsigned int thread, std::function<void(Tile)>& render)
+	{
+		Tile tile;
+		bool stolen;
+		while (next(thread, tile, stolen))
+		{
+			auto start = std::chrono::steady_clock::now();
+			render(tile);
+			statistics[thread].busy += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			statistics[thread].tiles++;
+			if (stolen)
+				statistics[thread].stolen++;
+		}
+	}
+
+	void TileScheduler::run(std::function<void(Tile)> render)
+	{
+		std::vector<Tile> tiles;
+		for (unsigned int y = 0; y < height; y += tileSize)
+		{
+			for (unsigned int x = 0; x < width; x += tileSize)
+			{
+				tiles.push_back({ x, y, (std::min)(tileSize, width - x), (std::min)(tileSize, height - y) });
+			}
+		}
+
+		// zusammenhaengende bloecke pro thread, damit ohne stehlen jeder in einem bildbereich bleibt
+		for (unsigned int i = 0; i < threadCount; i++)
+		{
+			size_t from = tiles.size() * i / threadCount;
+			size_t to = tiles.size() * (i + 1) / threadCount;
+			queues[i].tiles.assign(tiles.begin() + from, tiles.begin() + to);
+		}
+
+		statistics.assign(threadCount, { 0, 0, 0, 0 });
+
+		auto start = std::chrono::steady_clock::now();
+		std::vector<std::thread> threads;
+		for (unsigned int i = 1; i < threadCount; i++)
+		{
+			threads.push_back(std::thread(&TileScheduler::work, this, i, std::ref(render)));
+		}
+		work(0, render);
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+		totalTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		for (auto& e : statistics)
+		{
+			e.idle = totalTime - e.busy;
+		}
+	}
+
+	unsigned int TileScheduler::getThreadCount()
+	{
+		return threadCount;
+	}
+
+	std::vector<ThreadStatistics> TileScheduler::getStatistics()
+	{
+		return statistics;
+	}
+
+	void TileScheduler::printStatistics(std::ostream& stream)
+	{
+		stream << "total " << std::fixed << std::setprecision(1) << totalTime * 1000.0 << " ms on " << threadCount << " threads" << std::endl;
+		for (unsigned int i = 0; i < statistics.size(); i++)
+		{
+			stream << "thread " << std::setw(3) << i
+				<< "  busy " << std::setw(9) << statistics[i].busy * 1000.0 << " ms"
+				<< "  idle " << std::setw(9) << statistics[i].idle * 1000.0 << " ms"
+				<< "  tiles " << std::setw(6) << statistics[i].tiles
+				<< "  stolen " << std::setw(6) << statistics[i].stolen << std::endl;
+		}
+	}
+}
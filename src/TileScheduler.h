@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <functional>
+#include <ostream>
+
+namespace cg
+{
+	struct Tile
+	{
+		unsigned int x;
+		unsigned int y;
+		unsigned int width;
+		unsigned int height;
+	};
+
+	struct ThreadStatistics
+	{
+		double busy;
+		double idle;
+		unsigned int tiles;
+		unsigned int stolen;
+	};
+
+	// verteilt kleine kacheln auf so viele threads wie der rechner hat
+	// jeder thread arbeitet seine eigene warteschlange von vorne ab und stiehlt hinten bei den anderen, wenn sie leer ist
+	class TileScheduler
+	{
+	public:
+		TileScheduler(unsigned int width, unsigned int height, unsigned int tileSize = 16, unsigned int threadCount = 0);
+
+		void run(std::function<void(Tile)> render);
+		unsigned int getThreadCount();
+		std::vector<ThreadStatistics> getStatistics();
+		void printStatistics(std::ostream& stream);
+	private:
+		struct alignas(64) Queue
+		{
+			std::mutex mutex;
+			std::deque<Tile> tiles;
+		};
+
+		bool next(unsigned int thread, Tile& tile, bool& stolen);
+		void work(unsigned int thread, std::function<void(Tile)>& render);
+
+		unsigned int width, height;
+		unsigned int tileSize;
+		unsigned int threadCount;
+		std::vector<Queue> queues;
+		std::vector<ThreadStatistics> statistics;
+		double totalTime;
+	};
+}
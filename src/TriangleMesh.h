@@ -0,0 +1,166 @@
+#pragma once
+
+#include "PathTracing2.h"
+#include "MeshFile.h"
+
+#include <vector>
+#include <cstdint>
+#include <cmath>
+
+namespace path2
+{
+	// dreiecksnetz als ein einziges objekt der szene, mit eigener BVH ueber die dreiecke
+	// vertex- und indexarrays werden nicht kopiert, sie kommen z.b. direkt aus einer MappedMesh und muessen so lange leben wie das netz
+	template <class T>
+	class BasicTriangleMesh : public BasicRayTraceObject<T>
+	{
+	public:
+		BasicTriangleMesh(const float* vertices, unsigned int vertexCount, const uint32_t* indices, unsigned int triangleCount);
+		BasicTriangleMesh(const MappedMesh& mesh);
+		BasicTriangleMesh(const MeshData& mesh);
+
+		bool intersect(Vector<T, 3> origin, Vector<T, 3> direction, T tmin, T tmax, BasicHit<T>& hit);
+		bool occluded(Vector<T, 3> origin, Vector<T, 3> direction, T tmin, T tmax);
+		bool getBounds(AABB<T>& bounds);
+		// moeller-trumbore: schnitt mit einem einzelnen dreieck, t wird nur bei einem treffer mit tmin < t < tmax gesetzt
+		bool intersectTriangle(unsigned int triangle, Vector<T, 3> origin, Vector<T, 3> direction, T tmin, T tmax, T& t) const;
+		unsigned int getTriangleCount() const;
+		const BVH<T>& getBVH() const;
+	private:
+		Vector<T, 3> getVertex(uint32_t index) const;
+
+		const float* vertices;
+		unsigned int vertexCount;
+		const uint32_t* indices;
+		unsigned int triangleCount;
+		BVH<T> bvh;
+	};
+
+	using TriangleMesh = BasicTriangleMesh<double>;
+
+	// impl ---------------------------------
+
+	template<class T>
+	inline BasicTriangleMesh<T>::BasicTriangleMesh(const float* vertices, unsigned int vertexCount, const uint32_t* indices, unsigned int triangleCount)
+		: vertices(vertices), vertexCount(vertexCount), indices(indices), triangleCount(triangleCount)
+	{
+		std::vector<AABB<T>> bounds(triangleCount);
+		for (unsigned int i = 0; i < triangleCount; i++)
+		{
+			bounds[i].extend(getVertex(indices[i * 3]));
+			bounds[i].extend(getVertex(indices[i * 3 + 1]));
+			bounds[i].extend(getVertex(indices[i * 3 + 2]));
+		}
+		bvh.build(bounds);
+	}
+
+	template<class T>
+	inline BasicTriangleMesh<T>::BasicTriangleMesh(const MappedMesh& mesh) : BasicTriangleMesh(mesh.getVertices(), mesh.getVertexCount(), mesh.getIndices(), mesh.getTriangleCount())
+	{
+	}
+
+	template<class T>
+	inline BasicTriangleMesh<T>::BasicTriangleMesh(const MeshData& mesh) : BasicTriangleMesh(mesh.vertices.data(), mesh.vertices.size() / 3, mesh.indices.data(), mesh.indices.size() / 3)
+	{
+	}
+
+	template<class T>
+	inline Vector<T, 3> BasicTriangleMesh<T>::getVertex(uint32_t index) const
+	{
+		return { T(vertices[index * 3]), T(vertices[index * 3 + 1]), T(vertices[index * 3 + 2]) };
+	}
+
+	template<class T>
+	inline bool BasicTriangleMesh<T>::intersectTriangle(unsigned int triangle, Vector<T, 3> origin, Vector<T, 3> direction, T tmin, T tmax, T& t) const
+	{
+		Vector<T, 3> v0 = getVertex(indices[triangle * 3]);
+		Vector<T, 3> edge1 = getVertex(indices[triangle * 3 + 1]) - v0;
+		Vector<T, 3> edge2 = getVertex(indices[triangle * 3 + 2]) - v0;
+
+		Vector<T, 3> p = cross(direction, edge2);
+		T determinant = edge1 * p;
+		// strahl parallel zum dreieck
+		if (determinant == 0)
+			return false;
+		T inverse = T(1) / determinant;
+
+		Vector<T, 3> s = origin - v0;
+		T u = (s * p) * inverse;
+		if (u < 0 || u > 1)
+			return false;
+
+		Vector<T, 3> q = cross(s, edge1);
+		T v = (direction * q) * inverse;
+		if (v < 0 || u + v > 1)
+			return false;
+
+		T distance = (edge2 * q) * inverse;
+		if (distance <= tmin || distance >= tmax)
+			return false;
+		t = distance;
+		return true;
+	}
+
+	template<class T>
+	inline bool BasicTriangleMesh<T>::intersect(Vector<T, 3> origin, Vector<T, 3> direction, T tmin, T tmax, BasicHit<T>& hit)
+	{
+		const std::vector<unsigned int>& order = bvh.getIndices();
+		unsigned int found = triangleCount;
+		bvh.intersect(origin, direction, tmax, [&](unsigned int first, unsigned int count, T& limit)
+		{
+			bool hitLeaf = false;
+			for (unsigned int i = first; i < first + count; i++)
+			{
+				if (intersectTriangle(order[i], origin, direction, tmin, limit, limit))
+				{
+					found = order[i];
+					hitLeaf = true;
+				}
+			}
+			return hitLeaf;
+		});
+		if (found == triangleCount)
+			return false;
+
+		// geometrische normale, immer zur seite des strahls, damit der versatz in tracePlus vom dreieck weg zeigt
+		Vector<T, 3> v0 = getVertex(indices[found * 3]);
+		Vector<T, 3> normal = cross(getVertex(indices[found * 3 + 1]) - v0, getVertex(indices[found * 3 + 2]) - v0);
+		if (normal * direction > 0)
+			normal = -normal;
+		hit = { tmax, this, normal };
+		return true;
+	}
+
+	template<class T>
+	inline bool BasicTriangleMesh<T>::occluded(Vector<T, 3> origin, Vector<T, 3> direction, T tmin, T tmax)
+	{
+		const std::vector<unsigned int>& order = bvh.getIndices();
+		return bvh.occluded(origin, direction, tmax, [&](unsigned int first, unsigned int count, T& limit)
+		{
+			T t;
+			for (unsigned int i = first; i < first + count; i++)
+				if (intersectTriangle(order[i], origin, direction, tmin, limit, t))
+					return true;
+			return false;
+		});
+	}
+
+	template<class T>
+	inline bool BasicTriangleMesh<T>::getBounds(AABB<T>& bounds)
+	{
+		bounds = bvh.getBounds();
+		return !bounds.isEmpty();
+	}
+
+	template<class T>
+	inline unsigned int BasicTriangleMesh<T>::getTriangleCount() const
+	{
+		return triangleCount;
+	}
+
+	template<class T>
+	inline const BVH<T>& BasicTriangleMesh<T>::getBVH() const
+	{
+		return bvh;
+	}
+}
@@ -2,6 +2,10 @@
 
 #include <sstream>
 #include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
 
 namespace cg
 {
@@ -19,6 +23,48 @@ namespace cg
 		return result;
 	}
 
+	void readLines(const std::string& filename, std::function<void(const char* begin, const char* end)> line)
+	{
+		std::unique_ptr<std::FILE, int(*)(std::FILE*)> file(std::fopen(filename.c_str(), "rb"), std::fclose);
+		if (!file)
+			throw std::runtime_error("Could not open " + filename);
+
+		std::vector<char> buffer(1 << 20);
+		size_t size = 0;
+		while (true)
+		{
+			// eine zeile die laenger als der ganze puffer ist vergroessert ihn
+			if (size == buffer.size())
+				buffer.resize(buffer.size() * 2);
+
+			size_t count = std::fread(buffer.data() + size, 1, buffer.size() - size, file.get());
+			size += count;
+			bool last = count == 0;
+
+			const char* begin = buffer.data();
+			const char* end = buffer.data() + size;
+			while (begin < end)
+			{
+				const char* newline = static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+				if (newline == nullptr)
+				{
+					if (!last)
+						break;
+					newline = end;
+				}
+				line(begin, newline);
+				begin = newline == end ? end : newline + 1;
+			}
+
+			// angefangene zeile an den anfang schieben
+			size_t remaining = end - begin;
+			std::memmove(buffer.data(), begin, remaining);
+			size = remaining;
+			if (last)
+				break;
+		}
+	}
+
 	std::tuple<double, double, double> hsvToRgb(double h, double s, double v)
 	{
 		int hi = std::floor(h / 60);
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <vector>
+#include <string>
+#include <functional>
 
 namespace cg
 {
@@ -14,6 +16,9 @@ namespace cg
 	void insertBinaryDataInverse(std::vector<unsigned char> &data, T t, int pos);
 
 	std::vector<std::string> split(const std::string& s, char delim);
+	// liest eine textdatei blockweise und ruft line(begin, end) fuer jede zeile ohne das '\n' auf, ohne die zeilen zu kopieren
+	// wirft std::runtime_error, wenn die datei nicht geoeffnet werden kann
+	void readLines(const std::string& filename, std::function<void(const char* begin, const char* end)> line);
 
 	std::tuple<double, double, double> hsvToRgb(double h, double s, double v);
 
@@ -0,0 +1,575 @@
+#pragma once
+
+#include "PathTracing2.h"
+#include "TileScheduler.h"
+
+#include <vector>
+#include <chrono>
+#include <ostream>
+#include <iomanip>
+#include <algorithm>
+#include <cstdint>
+
+namespace path2
+{
+	// strahlen einer welle als struktur aus arrays, jeder schritt laeuft als eigene schleife ueber alle eintraege
+	template <class T>
+	struct RayQueue
+	{
+		void resize(unsigned int capacity);
+
+		unsigned int size;
+		// strahl
+		std::vector<T> originX, originY, originZ;
+		std::vector<T> directionX, directionY, directionZ;
+		// pfadzustand, der zufallsgenerator wird aus pixel, sample und dimension jedes mal neu aufgebaut
+		std::vector<T> throughputR, throughputG, throughputB;
+		std::vector<unsigned int> pixel;
+		std::vector<unsigned int> dimension;
+		std::vector<unsigned int> depth;
+		// pdf und art des letzten abpralls fuer das MIS gewicht der emission
+		std::vector<T> lastPdf;
+		std::vector<unsigned char> lastSpecular;
+		// bisher gesammeltes licht des pfads
+		std::vector<T> radianceR, radianceG, radianceB;
+		// ergebnis von intersect, object == nullptr bei keinem treffer
+		std::vector<T> distance;
+		std::vector<BasicRayTraceObject<T>*> object;
+		std::vector<T> normalX, normalY, normalZ;
+		// ergebnis von shade: laufende pfade kommen mit dem neuen strahl in die naechste welle, fertige gehen mit radiance in die ergebnisse
+		std::vector<unsigned char> alive;
+		// schattenstrahl der direkten beleuchtung vom neuen ursprung aus, shadowLight == nullptr wenn es keinen gibt
+		std::vector<T> shadowDirectionX, shadowDirectionY, shadowDirectionZ, shadowDistance;
+		std::vector<T> shadowRadianceR, shadowRadianceG, shadowRadianceB;
+		std::vector<BasicRayTraceObject<T>*> shadowLight;
+	};
+
+	// fertige pfade, die accumulate in den bildpuffer schreibt
+	template <class T>
+	struct ResultQueue
+	{
+		void resize(unsigned int capacity);
+
+		unsigned int size;
+		std::vector<unsigned int> pixel;
+		std::vector<T> radianceR, radianceG, radianceB;
+	};
+
+	// wavefront path tracer: statt jeden pfad einzeln mit tracePixel in die tiefe zu verfolgen, liegen bis zu queueSize strahlen in RayQueues
+	// und jeder schritt (generate -> intersect -> shade -> shadow -> extend -> accumulate) laeuft als eigene enge schleife ueber die ganze welle
+	// pro pixel und durchgang werden die gleichen zufallszahlen wie in ProgressiveRenderer verbraucht, die bilder sind also gleich
+	// die schleifen kennen nur die arrays, damit koennen sie spaeter als OpenCL kernel laufen
+	// mit setSorting werden die sekundaerstrahlen vor intersect blockweise nach morton code des ursprungs und richtungsoktant sortiert,
+	// benachbarte strahlen laufen dann meistens durch die gleichen knoten der BVH
+	template <class T>
+	class BasicWavefrontRenderer
+	{
+	public:
+		using Clock = std::chrono::steady_clock;
+
+		enum Stage { Generate, Intersect, Shade, Shadow, Extend, Sort, Accumulate, StageCount };
+
+		BasicWavefrontRenderer(const BasicScene<T>* scene, Vector<T, 3> origin, unsigned int width, unsigned int height, unsigned int queueSize = 1 << 18);
+
+		// maximale pfadlaenge wie bei tracePixel, standard 4
+		void setMaxDepth(unsigned int maxDepth);
+		// sortiert je blockSize aufeinanderfolgende sekundaerstrahlen, 0 schaltet das sortieren ab (standard)
+		void setSorting(unsigned int blockSize);
+		// folge fuer pixelversatz und abprallrichtungen, standard Independent
+		void setSampler(SampleSequence sequence);
+		// rendert bis sampleTarget samples pro pixel erreicht sind, gibt die anzahl durchgaenge zurueck
+		unsigned int render(unsigned int sampleTarget);
+		// ein sample fuer jedes pixel, das bild wird in wellen von hoechstens queueSize pixeln abgearbeitet
+		void renderPass();
+		Bitmap<unsigned char> getSnapshot();
+		unsigned int getPassCount();
+		// summierte zeit pro schritt in sekunden
+		double getStageTime(Stage stage);
+		void printStatistics(std::ostream& stream);
+	private:
+		// ruft kernel(i) fuer alle i < count auf, verteilt auf alle threads
+		template <class F>
+		void parallel(unsigned int count, F kernel);
+		void generate(unsigned int first, unsigned int count);
+		void intersect();
+		void shade();
+		void shadow();
+		void extend();
+		void sort();
+		void accumulate();
+		// 27 bit morton code des ursprungs in bounds, darunter 3 bit richtungsoktant
+		static uint32_t sortKey(Vector<T, 3> position, Vector<T, 3> direction, const AABB<T>& bounds);
+		static uint32_t expandBits(uint32_t value);
+
+		const BasicScene<T>* scene;
+		Vector<T, 3> origin;
+		unsigned int width, height;
+		unsigned int queueSize;
+		unsigned int maxDepth;
+		unsigned int sortBlock;
+		unsigned int passCount;
+		Bitmap<float> accumulation;
+		RayQueue<T> current;
+		RayQueue<T> next;
+		ResultQueue<T> results;
+		std::vector<uint64_t> sortKeys;
+		Sampler sampler;
+		TileScheduler scheduler;
+		double stageTime[StageCount];
+	};
+
+	using WavefrontRenderer = BasicWavefrontRenderer<double>;
+
+	// impl ---------------------------------
+
+	template<class T>
+	inline void RayQueue<T>::resize(unsigned int capacity)
+	{
+		size = 0;
+		for (auto array : { &originX, &originY, &originZ, &directionX, &directionY, &directionZ, &throughputR, &throughputG, &throughputB,
+			&lastPdf, &radianceR, &radianceG, &radianceB, &distance, &normalX, &normalY, &normalZ,
+			&shadowDirectionX, &shadowDirectionY, &shadowDirectionZ, &shadowDistance, &shadowRadianceR, &shadowRadianceG, &shadowRadianceB })
+			array->resize(capacity);
+		pixel.resize(capacity);
+		dimension.resize(capacity);
+		depth.resize(capacity);
+		lastSpecular.resize(capacity);
+		object.resize(capacity);
+		alive.resize(capacity);
+		shadowLight.resize(capacity);
+	}
+
+	template<class T>
+	inline void ResultQueue<T>::resize(unsigned int capacity)
+	{
+		size = 0;
+		pixel.resize(capacity);
+		radianceR.resize(capacity);
+		radianceG.resize(capacity);
+		radianceB.resize(capacity);
+	}
+
+	template<class T>
+	inline BasicWavefrontRenderer<T>::BasicWavefrontRenderer(const BasicScene<T>* scene, Vector<T, 3> origin, unsigned int width, unsigned int height, unsigned int queueSize)
+		: scene(scene), origin(origin), width(width), height(height), queueSize((std::min)(queueSize, width * height)), maxDepth(4), sortBlock(0), passCount(0),
+		accumulation(width, height, 3), sampler(SampleSequence::Independent, width, height), scheduler(this->queueSize, 1, 1024), stageTime()
+	{
+		accumulation.fill({ 0, 0, 0 });
+		current.resize(this->queueSize);
+		next.resize(this->queueSize);
+		results.resize(this->queueSize);
+	}
+
+	template<class T>
+	inline void BasicWavefrontRenderer<T>::setMaxDepth(unsigned int maxDepth)
+	{
+		this->maxDepth = maxDepth;
+	}
+
+	template<class T>
+	inline void BasicWavefrontRenderer<T>::setSorting(unsigned int blockSize)
+	{
+		sortBlock = blockSize;
+	}
+
+	template<class T>
+	inline void BasicWavefrontRenderer<T>::setSampler(SampleSequence sequence)
+	{
+		sampler = Sampler(sequence, width, height);
+	}
+
+	template<class T>
+	template<class F>
+	inline void BasicWavefrontRenderer<T>::parallel(unsigned int count, F kernel)
+	{
+		scheduler.run([&](Tile tile)
+		{
+			unsigned int end = (std::min)(tile.x + tile.width, count);
+			for (unsigned int i = tile.x; i < end; i++)
+				kernel(i);
+		});
+	}
+
+	template<class T>
+	inline unsigned int BasicWavefrontRenderer<T>::render(unsigned int sampleTarget)
+	{
+		while (passCount < sampleTarget)
+			renderPass();
+		return passCount;
+	}
+
+	template<class T>
+	inline void BasicWavefrontRenderer<T>::renderPass()
+	{
+		unsigned int pixelCount = width * height;
+		for (unsigned int first = 0; first < pixelCount; first += queueSize)
+		{
+			auto start = Clock::now();
+			generate(first, (std::min)(queueSize, pixelCount - first));
+			stageTime[Generate] += std::chrono::duration<double>(Clock::now() - start).count();
+
+			while (current.size > 0)
+			{
+				start = Clock::now();
+				intersect();
+				auto intersected = Clock::now();
+				shade();
+				auto shaded = Clock::now();
+				shadow();
+				auto shadowed = Clock::now();
+				extend();
+				auto extended = Clock::now();
+				sort();
+				auto sorted = Clock::now();
+				accumulate();
+				auto accumulated = Clock::now();
+
+				stageTime[Intersect] += std::chrono::duration<double>(intersected - start).count();
+				stageTime[Shade] += std::chrono::duration<double>(shaded - intersected).count();
+				stageTime[Shadow] += std::chrono::duration<double>(shadowed - shaded).count();
+				stageTime[Extend] += std::chrono::duration<double>(extended - shadowed).count();
+				stageTime[Sort] += std::chrono::duration<double>(sorted - extended).count();
+				stageTime[Accumulate] += std::chrono::duration<double>(accumulated - sorted).count();
+			}
+		}
+		passCount++;
+	}
+
+	template<class T>
+	inline void BasicWavefrontRenderer<T>::generate(unsigned int first, unsigned int count)
+	{
+		unsigned int sample = passCount;
+
+		current.size = count;
+		parallel(count, [&](unsigned int index)
+		{
+			// gleiche abtastung wie BasicProgressiveRenderer::renderTile
+			unsigned int pixel = first + index;
+			unsigned int i = pixel % width;
+			unsigned int j = pixel / width;
+			Random random(pixel, sample, 0, &sampler);
+			double offsetX, offsetY;
+			getPixelOffset(sample, random, sampler.getSequence(), offsetX, offsetY);
+			Vector<T, 3> dest = getScreenPoint<T>(i + offsetX, j + offsetY, width, height);
+			Vector<T, 3> direction = normalize(dest - origin);
+
+			current.originX[index] = origin(0);
+			current.originY[index] = origin(1);
+			current.originZ[index] = origin(2);
+			current.directionX[index] = direction(0);
+			current.directionY[index] = direction(1);
+			current.directionZ[index] = direction(2);
+			current.throughputR[index] = T(1);
+			current.throughputG[index] = T(1);
+			current.throughputB[index] = T(1);
+			current.pixel[index] = pixel;
+			current.dimension[index] = random.getDimension();
+			current.depth[index] = 0;
+			current.lastPdf[index] = T(0);
+			current.lastSpecular[index] = 1;
+			current.radianceR[index] = T(0);
+			current.radianceG[index] = T(0);
+			current.radianceB[index] = T(0);
+		});
+	}
+
+	template<class T>
+	inline void BasicWavefrontRenderer<T>::intersect()
+	{
+		RayQueue<T>& queue = current;
+		parallel(queue.size, [&](unsigned int index)
+		{
+			BasicHit<T> hit;
+			Vector<T, 3> position = { queue.originX[index], queue.originY[index], queue.originZ[index] };
+			Vector<T, 3> direction = { queue.directionX[index], queue.directionY[index], queue.directionZ[index] };
+			if (!trace(position, direction, *scene, hit))
+			{
+				queue.object[index] = nullptr;
+				return;
+			}
+			Vector<T, 3> normal = normalize(hit.normal);
+			queue.distance[index] = hit.distance;
+			queue.object[index] = hit.object;
+			queue.normalX[index] = normal(0);
+			queue.normalY[index] = normal(1);
+			queue.normalZ[index] = normal(2);
+		});
+	}
+
+	template<class T>
+	inline void BasicWavefrontRenderer<T>::shade()
+	{
+		// ab dieser tiefe entscheidet russisches roulette ueber den abbruch, wie in tracePixel
+		const unsigned int rouletteDepth = 2;
+
+		RayQueue<T>& queue = current;
+		parallel(queue.size, [&](unsigned int index)
+		{
+			Vector<T, 3> throughput = { queue.throughputR[index], queue.throughputG[index], queue.throughputB[index] };
+			Vector<T, 3> radiance = { queue.radianceR[index], queue.radianceG[index], queue.radianceB[index] };
+			BasicRayTraceObject<T>* object = queue.object[index];
+			queue.shadowLight[index] = nullptr;
+			if (object == nullptr)
+			{
+				// himmel
+				radiance = radiance + throughput;
+				queue.alive[index] = 0;
+				queue.radianceR[index] = radiance(0);
+				queue.radianceG[index] = radiance(1);
+				queue.radianceB[index] = radiance(2);
+				return;
+			}
+
+			Random random(queue.pixel[index], passCount, queue.dimension[index], &sampler);
+			Vector<T, 3> position = { queue.originX[index], queue.originY[index], queue.originZ[index] };
+			Vector<T, 3> direction = { queue.directionX[index], queue.directionY[index], queue.directionZ[index] };
+			Vector<T, 3> normal = { queue.normalX[index], queue.normalY[index], queue.normalZ[index] };
+
+			if (isEmissive(*object))
+			{
+				T weight = queue.lastSpecular[index] ? T(1) : emissionWeight(*scene, object, position, direction, queue.lastPdf[index]);
+				radiance += Vector<T, 3>{ throughput(0) * object->emission(0), throughput(1) * object->emission(1), throughput(2) * object->emission(2) } * weight;
+			}
+			position = position + direction * queue.distance[index] + normal * getRayOffset<T>();
+
+			// der schattenstrahl wird erst im naechsten schritt fuer die ganze welle verfolgt
+			LightSample<T> light;
+			if (sampleLight(*scene, *object, position, normal, random, light))
+			{
+				queue.shadowLight[index] = light.light;
+				queue.shadowDirectionX[index] = light.direction(0);
+				queue.shadowDirectionY[index] = light.direction(1);
+				queue.shadowDirectionZ[index] = light.direction(2);
+				queue.shadowDistance[index] = light.distance;
+				queue.shadowRadianceR[index] = throughput(0) * light.radiance(0);
+				queue.shadowRadianceG[index] = throughput(1) * light.radiance(1);
+				queue.shadowRadianceB[index] = throughput(2) * light.radiance(2);
+			}
+
+			BRDFSample<T> sample = sampleBRDF(*object, direction, normal, random);
+			throughput = { throughput(0) * sample.weight(0), throughput(1) * sample.weight(1), throughput(2) * sample.weight(2) };
+			direction = sample.direction;
+
+			unsigned int depth = queue.depth[index] + 1;
+			bool alive = true;
+			if (depth >= rouletteDepth)
+			{
+				T survival = (std::min)(T(0.95), (std::max)({ throughput(0), throughput(1), throughput(2) }));
+				if (random.next() >= survival)
+					alive = false;
+				else
+					throughput *= T(1) / survival;
+			}
+			// nach maxDepth treffern zaehlt nur noch das bisher gesammelte licht
+			if (depth >= maxDepth)
+				alive = false;
+
+			queue.alive[index] = alive;
+			queue.radianceR[index] = radiance(0);
+			queue.radianceG[index] = radiance(1);
+			queue.radianceB[index] = radiance(2);
+			queue.lastPdf[index] = sample.pdf;
+			queue.lastSpecular[index] = sample.specular;
+			queue.originX[index] = position(0);
+			queue.originY[index] = position(1);
+			queue.originZ[index] = position(2);
+			queue.directionX[index] = direction(0);
+			queue.directionY[index] = direction(1);
+			queue.directionZ[index] = direction(2);
+			queue.throughputR[index] = throughput(0);
+			queue.throughputG[index] = throughput(1);
+			queue.throughputB[index] = throughput(2);
+			queue.dimension[index] = random.getDimension();
+			queue.depth[index] = depth;
+		});
+	}
+
+	template<class T>
+	inline void BasicWavefrontRenderer<T>::shadow()
+	{
+		RayQueue<T>& queue = current;
+		parallel(queue.size, [&](unsigned int index)
+		{
+			if (queue.shadowLight[index] == nullptr)
+				return;
+			Vector<T, 3> position = { queue.originX[index], queue.originY[index], queue.originZ[index] };
+			Vector<T, 3> direction = { queue.shadowDirectionX[index], queue.shadowDirectionY[index], queue.shadowDirectionZ[index] };
+			if (!occluded(position, direction, *scene, queue.shadowDistance[index]))
+			{
+				queue.radianceR[index] += queue.shadowRadianceR[index];
+				queue.radianceG[index] += queue.shadowRadianceG[index];
+				queue.radianceB[index] += queue.shadowRadianceB[index];
+			}
+		});
+	}
+
+	template<class T>
+	inline void BasicWavefrontRenderer<T>::extend()
+	{
+		// kompaktieren: laufende pfade in die naechste welle, fertige in die ergebnisse, die reihenfolge bleibt erhalten
+		next.size = 0;
+		results.size = 0;
+		for (unsigned int i = 0; i < current.size; i++)
+		{
+			if (current.alive[i])
+			{
+				unsigned int n = next.size++;
+				next.originX[n] = current.originX[i];
+				next.originY[n] = current.originY[i];
+				next.originZ[n] = current.originZ[i];
+				next.directionX[n] = current.directionX[i];
+				next.directionY[n] = current.directionY[i];
+				next.directionZ[n] = current.directionZ[i];
+				next.throughputR[n] = current.throughputR[i];
+				next.throughputG[n] = current.throughputG[i];
+				next.throughputB[n] = current.throughputB[i];
+				next.pixel[n] = current.pixel[i];
+				next.dimension[n] = current.dimension[i];
+				next.depth[n] = current.depth[i];
+				next.lastPdf[n] = current.lastPdf[i];
+				next.lastSpecular[n] = current.lastSpecular[i];
+				next.radianceR[n] = current.radianceR[i];
+				next.radianceG[n] = current.radianceG[i];
+				next.radianceB[n] = current.radianceB[i];
+			}
+			else
+			{
+				unsigned int n = results.size++;
+				results.pixel[n] = current.pixel[i];
+				results.radianceR[n] = current.radianceR[i];
+				results.radianceG[n] = current.radianceG[i];
+				results.radianceB[n] = current.radianceB[i];
+			}
+		}
+		std::swap(current, next);
+	}
+
+	template<class T>
+	inline void BasicWavefrontRenderer<T>::sort()
+	{
+		if (sortBlock == 0 || current.size < 2)
+			return;
+
+		AABB<T> bounds;
+		for (unsigned int i = 0; i < current.size; i++)
+			bounds.extend(Vector<T, 3>{ current.originX[i], current.originY[i], current.originZ[i] });
+
+		// schluessel in den oberen 32 bit, alter index in den unteren, damit reicht ein sort ueber uint64_t
+		sortKeys.resize(current.size);
+		for (unsigned int i = 0; i < current.size; i++)
+		{
+			Vector<T, 3> position = { current.originX[i], current.originY[i], current.originZ[i] };
+			Vector<T, 3> direction = { current.directionX[i], current.directionY[i], current.directionZ[i] };
+			sortKeys[i] = (uint64_t(sortKey(position, direction, bounds)) << 32) | i;
+		}
+		for (unsigned int first = 0; first < current.size; first += sortBlock)
+			std::sort(sortKeys.begin() + first, sortKeys.begin() + (std::min)(first + sortBlock, current.size));
+
+		// in sortierter reihenfolge nach next umkopieren und die wellen tauschen
+		parallel(current.size, [&](unsigned int n)
+		{
+			unsigned int i = uint32_t(sortKeys[n]);
+			next.originX[n] = current.originX[i];
+			next.originY[n] = current.originY[i];
+			next.originZ[n] = current.originZ[i];
+			next.directionX[n] = current.directionX[i];
+			next.directionY[n] = current.directionY[i];
+			next.directionZ[n] = current.directionZ[i];
+			next.throughputR[n] = current.throughputR[i];
+			next.throughputG[n] = current.throughputG[i];
+			next.throughputB[n] = current.throughputB[i];
+			next.pixel[n] = current.pixel[i];
+			next.dimension[n] = current.dimension[i];
+			next.depth[n] = current.depth[i];
+			next.lastPdf[n] = current.lastPdf[i];
+			next.lastSpecular[n] = current.lastSpecular[i];
+			next.radianceR[n] = current.radianceR[i];
+			next.radianceG[n] = current.radianceG[i];
+			next.radianceB[n] = current.radianceB[i];
+		});
+		next.size = current.size;
+		std::swap(current, next);
+	}
+
+	template<class T>
+	inline uint32_t BasicWavefrontRenderer<T>::expandBits(uint32_t value)
+	{
+		// 9 bit auf jedes dritte bit verteilen
+		value &= 0x1ff;
+		value = (value | (value << 16)) & 0x030000ff;
+		value = (value | (value << 8)) & 0x0300f00f;
+		value = (value | (value << 4)) & 0x030c30c3;
+		value = (value | (value << 2)) & 0x09249249;
+		return value;
+	}
+
+	template<class T>
+	inline uint32_t BasicWavefrontRenderer<T>::sortKey(Vector<T, 3> position, Vector<T, 3> direction, const AABB<T>& bounds)
+	{
+		uint32_t octant = (direction(0) < 0 ? 4 : 0) | (direction(1) < 0 ? 2 : 0) | (direction(2) < 0 ? 1 : 0);
+		Vector<T, 3> min = bounds.min;
+		Vector<T, 3> max = bounds.max;
+		uint32_t morton = 0;
+		for (unsigned int axis = 0; axis < 3; axis++)
+		{
+			T extent = max(axis) - min(axis);
+			T relative = extent > 0 ? (position(axis) - min(axis)) / extent : T(0);
+			uint32_t cell = (std::min)(uint32_t(relative * T(512)), 511u);
+			morton |= expandBits(cell) << (2 - axis);
+		}
+		return (morton << 3) | octant;
+	}
+
+	template<class T>
+	inline void BasicWavefrontRenderer<T>::accumulate()
+	{
+		// jedes pixel ist hoechstens einmal pro welle fertig, es gibt also keine konflikte zwischen den threads
+		parallel(results.size, [&](unsigned int index)
+		{
+			unsigned int pixel = results.pixel[index];
+			unsigned int i = pixel % width;
+			unsigned int j = pixel / width;
+			accumulation(i, j, 0) += results.radianceR[index];
+			accumulation(i, j, 1) += results.radianceG[index];
+			accumulation(i, j, 2) += results.radianceB[index];
+		});
+	}
+
+	template<class T>
+	inline Bitmap<unsigned char> BasicWavefrontRenderer<T>::getSnapshot()
+	{
+		Bitmap<unsigned char> bitmap(width, height, 3);
+		for (unsigned int i = 0; i < width; i++)
+		{
+			for (unsigned int j = 0; j < height; j++)
+			{
+				for (unsigned int c = 0; c < 3; c++)
+				{
+					double value = passCount == 0 ? 0.0 : accumulation(i, j, c) / passCount;
+					bitmap(i, j, c) = std::min(value * 255, 255.0);
+				}
+			}
+		}
+		return bitmap;
+	}
+
+	template<class T>
+	inline unsigned int BasicWavefrontRenderer<T>::getPassCount()
+	{
+		return passCount;
+	}
+
+	template<class T>
+	inline double BasicWavefrontRenderer<T>::getStageTime(Stage stage)
+	{
+		return stageTime[stage];
+	}
+
+	template<class T>
+	inline void BasicWavefrontRenderer<T>::printStatistics(std::ostream& stream)
+	{
+		const char* names[StageCount] = { "generate", "intersect", "shade", "shadow", "extend", "sort", "accumulate" };
+		for (unsigned int i = 0; i < StageCount; i++)
+			stream << std::setw(12) << names[i] << std::setw(10) << std::fixed << std::setprecision(1) << stageTime[i] * 1000.0 << " ms" << std::endl;
+	}
+}